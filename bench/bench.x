@@ -0,0 +1,8 @@
+records: {
+    id: int.
+    name: string.
+    score: real.
+    active: bool.
+    tags: string[].
+    samples: real[].
+}[].
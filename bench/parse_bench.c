@@ -0,0 +1,214 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "jslex.h"
+#include "json_dom.h"
+#include "bench.h"
+
+#define RECORDS 20000
+#define ROUNDS 20
+
+static char* make_document(size_t* length)
+{
+    size_t size = RECORDS * 192 + 64;
+    char* json = malloc(size);
+    if(!json)
+        return NULL;
+
+    size_t i = snprintf(json, size, "{\"records\": [");
+
+    int k;
+    for(k = 0; k < RECORDS; ++k)
+        i += snprintf(&json[i], size - i,
+                      "%s{\"id\": %d, \"name\": \"record %d\", "
+                      "\"score\": %d.25, \"active\": %s, "
+                      "\"tags\": [\"a\", \"b\\n\"], "
+                      "\"samples\": [%d.5, 0.1, 1e-3, -273.15]}",
+                      k ? ", " : "", k, k, k, k % 2 ? "true" : "false", k);
+
+    i += snprintf(&json[i], size - i, "]}");
+
+    *length = i;
+    return json;
+}
+
+static double now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void report(const char* name, double seconds, size_t length)
+{
+    printf("%-12s %8.1f MB/s\n", name, length * ROUNDS / seconds / 1e6);
+}
+
+static int bench_schema(const char* json, size_t length)
+{
+    struct bench obj;
+    memset(&obj, 0, sizeof(obj));
+
+    double start = now();
+
+    int i;
+    for(i = 0; i < ROUNDS; ++i)
+        if(bench_unpack_reuse(&obj, json) < 0)
+            return -1;
+
+    report("schema", now() - start, length);
+
+    bench_cleanup(&obj);
+    return 0;
+}
+
+static int bench_dom(const char* json, size_t length)
+{
+    struct json_dom dom;
+    memset(&dom, 0, sizeof(dom));
+
+    double start = now();
+
+    int i;
+    for(i = 0; i < ROUNDS; ++i)
+        if(json_dom_parse(&dom, json, length) < 0)
+            return -1;
+
+    report("dom", now() - start, length);
+
+    json_dom_cleanup(&dom);
+    return 0;
+}
+
+static int bench_tape(const char* json, size_t length)
+{
+    struct json_tape tape;
+    memset(&tape, 0, sizeof(tape));
+
+    double start = now();
+
+    int i;
+    for(i = 0; i < ROUNDS; ++i)
+    {
+        struct jslex lexer;
+        if(jslex_init(&lexer, json) < 0)
+            return -1;
+
+        int r = json_tape_parse(&tape, &lexer);
+        jslex_cleanup(&lexer);
+
+        if(r < 0)
+            return -1;
+    }
+
+    report("tape", now() - start, length);
+
+    json_tape_cleanup(&tape);
+    return 0;
+}
+
+static int bench_packing(const char* json)
+{
+    struct bench obj;
+    memset(&obj, 0, sizeof(obj));
+
+    if(bench_unpack(&obj, json) < 0)
+        return -1;
+
+    size_t length = 0;
+    double start = now();
+
+    int i;
+    for(i = 0; i < ROUNDS; ++i)
+    {
+        char* packed = bench_pack(&obj);
+        if(!packed)
+            return -1;
+
+        length = strlen(packed);
+        free(packed);
+    }
+
+    report("pack", now() - start, length);
+
+    bench_cleanup(&obj);
+    return 0;
+}
+
+/* The records are split into small documents which are packed as one batch
+ * by an increasing number of threads.
+ */
+static int bench_parallel(const char* json)
+{
+    struct bench obj;
+    memset(&obj, 0, sizeof(obj));
+
+    if(bench_unpack(&obj, json) < 0)
+        return -1;
+
+    size_t per_document = 10;
+    size_t n = obj.length_of_records / per_document;
+    struct bench* documents = calloc(n, sizeof(*documents));
+    if(!documents)
+        return -1;
+
+    size_t i;
+    for(i = 0; i < n; ++i)
+    {
+        documents[i].is_set_records = 1;
+        documents[i].length_of_records = per_document;
+        documents[i].records = &obj.records[i * per_document];
+    }
+
+    int threads;
+    for(threads = 1; threads <= 8; threads *= 2)
+    {
+        struct json_pool pool;
+        if(json_pool_init(&pool, threads) < 0)
+            return -1;
+
+        size_t length = 0;
+        double start = now();
+
+        int k;
+        for(k = 0; k < ROUNDS; ++k)
+        {
+            struct json_batch batch;
+            if(bench_pack_many_parallel(&pool, documents, n, &batch) < 0)
+                return -1;
+
+            length = batch.length;
+            json_batch_cleanup(&batch);
+        }
+
+        char name[16];
+        snprintf(name, sizeof(name), "parallel %d", threads);
+        report(name, now() - start, length);
+
+        json_pool_cleanup(&pool);
+    }
+
+    free(documents);
+    bench_cleanup(&obj);
+    return 0;
+}
+
+int main()
+{
+    size_t length;
+    char* json = make_document(&length);
+    if(!json)
+        return 1;
+
+    printf("%zu bytes, %d rounds\n", length, ROUNDS);
+
+    int r = bench_schema(json, length) < 0
+         || bench_dom(json, length) < 0
+         || bench_tape(json, length) < 0
+         || bench_packing(json) < 0
+         || bench_parallel(json) < 0;
+
+    free(json);
+    return r;
+}
@@ -17,164 +17,386 @@
 
 /* Grammar:
  * members <- member+
- * member <- name ':' type length? term
+ * member <- name ':' type length? attribute* term
  * name <- literal
- * type <- object / 'real' / 'integer' / 'bool' / 'any'
- * length <- '[' integer? ']'
+ * type <- object / enum / 'real' / 'int' / 'bool' / string / 'any' / number
+ * string <- 'string' ( '(' integer ')' )?
+ * number <- 'i8' / 'i16' / 'i32' / 'i64' / 'u8' / 'u16' / 'u32' / 'u64'
+ *         / 'f32' / 'f64'
+ * length <- '[' integer? ']' ( '[' ']' )?
+ * attribute <- 'stream' ( '(' integer ')' )? / 'columnar' / 'interned'
  * term <- '.' | '?'
  * object <- '{' members '}'
+ * enum <- 'enum' '(' literal ( ',' literal )* ')'
  */
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <strings.h>
 #include "jslex.h"
 #include "obj.h"
+#include "desc_parser.h"
 
-#define EXPECT_STACK_MAX_SIZE 128
+/* The length of inline strings is stored in a single byte */
+#define INLINE_STRING_MAX_LENGTH 255
 
-enum error_type {
-    E_UNKNOWN = 0,
-    E_OOM,
-    E_UNKNOWN_TOKEN,
-    E_UNEXPECTED_TOKEN
-};
-
-static struct jslex lexer_;
-struct jslex_token* token_;
-
-static enum error_type error_;
+/* Batches of streamed arrays are stored inline in the structure */
+#define STREAM_BATCH_MAX_SIZE 4096
 
-static int expect_stack_index_ = 0;
-static enum jslex_token_type expect_stack_[EXPECT_STACK_MAX_SIZE];
-
-static inline void expect_stack_push(enum jslex_token_type type)
+static inline void expect_stack_push(struct desc_parser* self,
+                                     enum jslex_token_type type)
 {
-    if(expect_stack_index_ < EXPECT_STACK_MAX_SIZE)
-        expect_stack_[expect_stack_index_++] = type;
+    if(self->expect_stack_index < DESC_PARSER_EXPECT_STACK_MAX_SIZE)
+        self->expect_stack[self->expect_stack_index++] = type;
 }
 
-static inline void next_token()
+static inline void next_token(struct desc_parser* self)
 {
-    token_ = jslex_next_token(&lexer_);
+    self->token = jslex_next_token(&self->lexer);
 }
 
-static inline int accept_token()
+static inline int accept_token(struct desc_parser* self)
 {
-    error_ = 0;
-    expect_stack_index_ = 0;
-    jslex_accept_token(&lexer_);
+    self->error = DESC_E_UNKNOWN;
+    self->expect_stack_index = 0;
+    jslex_accept_token(&self->lexer);
     return 1;
 }
 
-static int expect(enum jslex_token_type type)
+static int expect(struct desc_parser* self, enum jslex_token_type type)
 {
-    next_token();
-    if(!token_)
+    next_token(self);
+    if(!self->token)
     {
-        error_ = E_UNKNOWN_TOKEN;
+        self->error = DESC_E_UNKNOWN_TOKEN;
         return 0;
     }
 
-    if(token_->type != type)
+    if(self->token->type != type)
     {
-        error_ = E_UNEXPECTED_TOKEN;
-        expect_stack_push(type);
+        self->error = DESC_E_UNEXPECTED_TOKEN;
+        expect_stack_push(self, type);
         return 0;
     }
 
     return 1;
 }
 
-static int name(struct obj* obj)
+static int name(struct desc_parser* self, struct obj* obj)
 {
-    if(!expect(JSLEX_LITERAL))
+    if(!expect(self, JSLEX_LITERAL))
         return 0;
 
-    obj_set_name(obj, token_->value.str);
+    obj_set_name(obj, self->token->value.str);
+
+    return accept_token(self);
+}
 
-    return accept_token();
+static inline int colon(struct desc_parser* self)
+{
+    return expect(self, JSLEX_COLON) && accept_token(self);
 }
 
-static inline int colon()    { return expect(JSLEX_COLON) && accept_token(); }
-static inline int dot()      { return expect(JSLEX_DOT)   && accept_token(); }
+static inline int dot(struct desc_parser* self)
+{
+    return expect(self, JSLEX_DOT) && accept_token(self);
+}
 
-static inline int lbracket()
+static inline int comma(struct desc_parser* self)
 {
-    return expect(JSLEX_LBRACKET) && accept_token();
+    return expect(self, JSLEX_COMMA) && accept_token(self);
 }
 
-static inline int rbracket()
+static inline int lparen(struct desc_parser* self)
 {
-    return expect(JSLEX_RBRACKET) && accept_token();
+    return expect(self, JSLEX_LPAREN) && accept_token(self);
 }
 
-static inline int lbrace()
+static inline int rparen(struct desc_parser* self)
 {
-    return expect(JSLEX_LBRACE) && accept_token();
+    return expect(self, JSLEX_RPAREN) && accept_token(self);
 }
 
-static inline int rbrace()
+static inline int lbracket(struct desc_parser* self)
 {
-    return expect(JSLEX_RBRACE) && accept_token();
+    return expect(self, JSLEX_LBRACKET) && accept_token(self);
 }
 
-static int length(struct obj* obj)
+static inline int rbracket(struct desc_parser* self)
 {
-    if(expect(JSLEX_INTEGER))
+    return expect(self, JSLEX_RBRACKET) && accept_token(self);
+}
+
+static inline int lbrace(struct desc_parser* self)
+{
+    return expect(self, JSLEX_LBRACE) && accept_token(self);
+}
+
+static inline int rbrace(struct desc_parser* self)
+{
+    return expect(self, JSLEX_RBRACE) && accept_token(self);
+}
+
+static inline int is_nestable(const struct obj* obj)
+{
+    return obj->length == -1 && (obj->type == OBJ_INTEGER
+                              || obj->type == OBJ_REAL
+                              || obj->type == OBJ_BOOL);
+}
+
+static int inner_length(struct desc_parser* self, struct obj* obj)
+{
+    if(!is_nestable(obj))
+    {
+        self->error = DESC_E_INVALID_NESTED_ARRAY;
+        return 0;
+    }
+
+    obj->dimensions = 2;
+
+    return rbracket(self);
+}
+
+static int length(struct desc_parser* self, struct obj* obj)
+{
+    if(expect(self, JSLEX_INTEGER))
     {
-        obj->length = token_->value.integer;
-        accept_token();
+        obj->length = self->token->value.integer;
+        accept_token(self);
     }
     else
     {
         obj->length = -1;
     }
 
-    return rbracket();
+    return rbracket(self)
+        && (lbracket(self) ? inner_length(self, obj) : 1);
+}
+
+static int batch_size(struct desc_parser* self, struct obj* obj)
+{
+    if(!expect(self, JSLEX_INTEGER))
+        return 0;
+
+    if(self->token->value.integer < 1
+       || self->token->value.integer > STREAM_BATCH_MAX_SIZE)
+    {
+        self->error = DESC_E_INVALID_ATTRIBUTE;
+        return 0;
+    }
+
+    obj->batch_size = self->token->value.integer;
+    accept_token(self);
+
+    return rparen(self);
+}
+
+static inline int is_streamable(const struct obj* obj)
+{
+    return obj->length == -1 && obj->dimensions == 1 && (obj->type == OBJ_INTEGER
+                              || obj->type == OBJ_REAL
+                              || obj->type == OBJ_BOOL);
+}
+
+static inline int is_column(const struct obj* obj)
+{
+    return obj->length == 1 && (obj->type == OBJ_INTEGER
+                             || obj->type == OBJ_REAL
+                             || obj->type == OBJ_BOOL);
+}
+
+static int is_columnable(const struct obj* obj)
+{
+    if(obj->length != -1 || obj->type != OBJ_OBJECT)
+        return 0;
+
+    const struct obj* child;
+    for(child = obj->children; child; child = child->next)
+        if(!is_column(child))
+            return 0;
+
+    return 1;
+}
+
+static inline int is_internable(const struct obj* obj)
+{
+    return obj->type == OBJ_STRING && obj->length == 1 && !obj->max_length;
+}
+
+static int attribute(struct desc_parser* self, struct obj* obj)
+{
+    if(!expect(self, JSLEX_LITERAL))
+        return 0;
+
+    if(0 == strcmp("stream", self->token->value.str) && is_streamable(obj))
+    {
+        obj->is_stream = 1;
+        accept_token(self);
+        return lparen(self) ? batch_size(self, obj) : 1;
+    }
+
+    if(0 == strcmp("columnar", self->token->value.str) && is_columnable(obj))
+    {
+        obj->is_columnar = 1;
+        return accept_token(self);
+    }
+
+    if(0 == strcmp("interned", self->token->value.str) && is_internable(obj))
+    {
+        obj->is_interned = 1;
+        return accept_token(self);
+    }
+
+    self->error = DESC_E_INVALID_ATTRIBUTE;
+    return 0;
+}
+
+static int attributes(struct desc_parser* self, struct obj* obj)
+{
+    while(expect(self, JSLEX_LITERAL))
+        if(!attribute(self, obj))
+            return 0;
+
+    return 1;
 }
 
-static int qmark(struct obj* obj)
+static int qmark(struct desc_parser* self, struct obj* obj)
 {
-    if(!expect(JSLEX_QMARK))
+    if(!expect(self, JSLEX_QMARK))
         return 0;
 
     obj->is_optional = 1;
 
-    return accept_token();
+    return accept_token(self);
 }
 
-static inline int decls(struct obj* obj);
+static inline int decls(struct desc_parser* self, struct obj* obj);
+
+static const struct {
+    const char* name;
+    enum obj_type type;
+    enum obj_number number;
+} literal_types_[] = {
+    { "string", OBJ_STRING,  OBJ_NUMBER_DEFAULT },
+    { "int",    OBJ_INTEGER, OBJ_NUMBER_DEFAULT },
+    { "real",   OBJ_REAL,    OBJ_NUMBER_DEFAULT },
+    { "bool",   OBJ_BOOL,    OBJ_NUMBER_DEFAULT },
+    { "any",    OBJ_ANY,     OBJ_NUMBER_DEFAULT },
+    { "i8",     OBJ_INTEGER, OBJ_NUMBER_I8 },
+    { "i16",    OBJ_INTEGER, OBJ_NUMBER_I16 },
+    { "i32",    OBJ_INTEGER, OBJ_NUMBER_I32 },
+    { "i64",    OBJ_INTEGER, OBJ_NUMBER_I64 },
+    { "u8",     OBJ_INTEGER, OBJ_NUMBER_U8 },
+    { "u16",    OBJ_INTEGER, OBJ_NUMBER_U16 },
+    { "u32",    OBJ_INTEGER, OBJ_NUMBER_U32 },
+    { "u64",    OBJ_INTEGER, OBJ_NUMBER_U64 },
+    { "f32",    OBJ_REAL,    OBJ_NUMBER_F32 },
+    { "f64",    OBJ_REAL,    OBJ_NUMBER_F64 },
+};
 
-static int literal_type(struct obj* obj)
+static int max_length(struct desc_parser* self, struct obj* obj)
 {
-    if(!expect(JSLEX_LITERAL))
+    if(!expect(self, JSLEX_INTEGER))
         return 0;
 
-    if(0 == strcmp("string", token_->value.str))
-        obj->type = OBJ_STRING;
-    else if(0 == strcmp("int", token_->value.str))
-        obj->type = OBJ_INTEGER;
-    else if(0 == strcmp("real", token_->value.str))
-        obj->type = OBJ_REAL;
-    else if(0 == strcmp("bool", token_->value.str))
-        obj->type = OBJ_BOOL;
-    else if(0 == strcmp("any", token_->value.str))
-        obj->type = OBJ_ANY;
-    else
+    if(self->token->value.integer < 1
+       || self->token->value.integer > INLINE_STRING_MAX_LENGTH)
+    {
+        self->error = DESC_E_INVALID_INLINE_STRING;
         return 0;
+    }
+
+    obj->max_length = self->token->value.integer;
+    accept_token(self);
+
+    return rparen(self);
+}
+
+static int literal_type(struct desc_parser* self, struct obj* obj)
+{
+    if(!expect(self, JSLEX_LITERAL))
+        return 0;
+
+    size_t i;
+    for(i = 0; i < sizeof(literal_types_) / sizeof(literal_types_[0]); ++i)
+        if(0 == strcmp(literal_types_[i].name, self->token->value.str))
+        {
+            obj->type = literal_types_[i].type;
+            obj->number = literal_types_[i].number;
+            return accept_token(self);
+        }
+
+    return 0;
+}
+
+/* The generated enumerators are upper case, so values which only differ in
+ * case would clash.
+ */
+static int has_enum_value(const struct obj* obj, const char* name)
+{
+    const struct obj* value;
+    for(value = obj->children; value; value = value->next)
+        if(0 == strcasecmp(value->name, name))
+            return 1;
+
+    return 0;
+}
+
+static int enum_values(struct desc_parser* self, struct obj* obj)
+{
+    struct obj** tail = &obj->children;
+
+    do
+    {
+        if(!expect(self, JSLEX_LITERAL))
+            return 0;
+
+        if(has_enum_value(obj, self->token->value.str))
+        {
+            self->error = DESC_E_INVALID_ENUM;
+            return 0;
+        }
+
+        struct obj* value = obj_new();
+        if(!value)
+        {
+            self->error = DESC_E_OOM;
+            return 0;
+        }
+
+        obj_set_name(value, self->token->value.str);
+        *tail = value;
+        tail = &value->next;
+
+        accept_token(self);
+    } while(comma(self));
 
-    return accept_token();
+    return rparen(self);
 }
 
-static int object(struct obj* obj)
+static inline int is_enumeration(struct desc_parser* self)
 {
-    if(!lbrace())
+    return expect(self, JSLEX_LITERAL)
+        && 0 == strcmp("enum", self->token->value.str);
+}
+
+static int enumeration(struct desc_parser* self, struct obj* obj)
+{
+    accept_token(self);
+    obj->type = OBJ_ENUM;
+
+    return lparen(self) && enum_values(self, obj);
+}
+
+static int object(struct desc_parser* self, struct obj* obj)
+{
+    if(!lbrace(self))
        return 0;
 
     obj->type = OBJ_OBJECT;
     obj->children = obj_new();
 
-    if(!(decls(obj->children) && rbrace()))
+    if(!(decls(self, obj->children) && rbrace(self)))
     {
         obj_free(obj->children);
         obj->children = NULL;
@@ -184,37 +406,70 @@ static int object(struct obj* obj)
     return 1;
 }
 
-static inline int type(struct obj* obj)
+static inline int type(struct desc_parser* self, struct obj* obj)
 {
-    return literal_type(obj) || object(obj);
+    if(is_enumeration(self))
+        return enumeration(self, obj);
+
+    if(!literal_type(self, obj))
+        return object(self, obj);
+
+    return obj->type == OBJ_STRING && lparen(self) ? max_length(self, obj) : 1;
 }
 
-static inline int decl(struct obj* obj)
+static inline int scalar_enum(struct desc_parser* self,
+                              const struct obj* obj)
 {
-    return name(obj)
-        && colon()
-        && type(obj)
-        && (lbracket() ? length(obj) : 1)
-        && (dot() || qmark(obj));
+    if(obj->type == OBJ_ENUM && obj->length != 1)
+    {
+        self->error = DESC_E_INVALID_ENUM;
+        return 0;
+    }
+
+    return 1;
 }
 
-static int decls(struct obj* obj)
+static inline int scalar_inline_string(struct desc_parser* self,
+                                       const struct obj* obj)
 {
-    if(!decl(obj))
+    if(obj->max_length && obj->length != 1)
+    {
+        self->error = DESC_E_INVALID_INLINE_STRING;
+        return 0;
+    }
+
+    return 1;
+}
+
+static inline int decl(struct desc_parser* self, struct obj* obj)
+{
+    return name(self, obj)
+        && colon(self)
+        && type(self, obj)
+        && (lbracket(self) ? length(self, obj) : 1)
+        && scalar_enum(self, obj)
+        && scalar_inline_string(self, obj)
+        && attributes(self, obj)
+        && (dot(self) || qmark(self, obj));
+}
+
+static int decls(struct desc_parser* self, struct obj* obj)
+{
+    if(!decl(self, obj))
         return 0;
 
     struct obj* next;
 
     while(1)
     {
-        if(expect(JSLEX_RBRACE) || expect(JSLEX_EOF))
+        if(expect(self, JSLEX_RBRACE) || expect(self, JSLEX_EOF))
             break;
 
-        if(!expect(JSLEX_LITERAL))
+        if(!expect(self, JSLEX_LITERAL))
             return 0;
 
         next = obj_new();
-        if(!decl(next))
+        if(!decl(self, next))
         {
             obj_free(next);
             return 0;
@@ -227,76 +482,107 @@ static int decls(struct obj* obj)
     return 1;
 }
 
-static int desc(struct obj* obj)
+static int desc(struct desc_parser* self, struct obj* obj)
 {
-    return decls(obj) && expect(JSLEX_EOF);
+    return decls(self, obj) && expect(self, JSLEX_EOF);
 }
 
-struct obj* desc_parse(const char* input)
+struct obj* desc_parse(struct desc_parser* self, const char* input)
 {
+    self->token = NULL;
+    self->error = DESC_E_UNKNOWN;
+    self->expect_stack_index = 0;
+
     struct obj* obj = obj_new();
+    if(!obj)
+    {
+        self->error = DESC_E_OOM;
+        return NULL;
+    }
 
-    if(jslex_init(&lexer_, input) < 0)
-        goto failure;
+    if(jslex_init(&self->lexer, input) < 0)
+    {
+        obj_free(obj);
+        return NULL;
+    }
 
-    if(!desc(obj))
+    if(!desc(self, obj))
         goto failure;
 
-    jslex_cleanup(&lexer_);
+    jslex_cleanup(&self->lexer);
     return obj;
 
 failure:
-    jslex_cleanup(&lexer_);
+    jslex_cleanup(&self->lexer);
     obj_free(obj);
     return NULL;
 }
 
-static void print_error_position()
+static void print_error_position(const struct desc_parser* self, FILE* stream)
 {
-    fprintf(stderr, "Line %d:\n", lexer_.current_line);
-    fprintf(stderr, "%.*s\n", strcspn(lexer_.line_start, "\n"),
-                              lexer_.line_start);
-    fprintf(stderr, "%*s^-- here\n", lexer_.pos - lexer_.line_start, "");
+    const struct jslex* lexer = &self->lexer;
+
+    fprintf(stream, "Line %d:\n", lexer->current_line);
+    fprintf(stream, "%.*s\n", (int)strcspn(lexer->line_start, "\n"),
+                              lexer->line_start);
+    fprintf(stream, "%*s^-- here\n", (int)(lexer->pos - lexer->line_start), "");
 }
 
-static void print_expected()
+static void print_expected(const struct desc_parser* self, FILE* stream)
 {
-    if(expect_stack_index_ == 0)
+    if(self->expect_stack_index == 0)
         return;
 
-    fprintf(stderr, "Expected: '%s'", jslex_tokstr(expect_stack_[0]));
+    fprintf(stream, "Expected: '%s'", jslex_tokstr(self->expect_stack[0]));
 
     int i;
-    for(i = 1; i < expect_stack_index_; ++i)
-        fprintf(stderr, "%s'%s'", i != expect_stack_index_ - 1 ? ", " : " or ",
-                                  jslex_tokstr(expect_stack_[i]));
+    for(i = 1; i < self->expect_stack_index; ++i)
+        fprintf(stream, "%s'%s'",
+                i != self->expect_stack_index - 1 ? ", " : " or ",
+                jslex_tokstr(self->expect_stack[i]));
 
-    fprintf(stderr, ".\n");
+    fprintf(stream, ".\n");
 }
 
-void desc_print_error_report()
+void desc_print_error_report(const struct desc_parser* self, FILE* stream)
 {
-    switch(error_)
+    switch(self->error)
     {
-    case E_UNKNOWN:
-        fprintf(stderr, "Unknown error.\n");
+    case DESC_E_UNKNOWN:
+        fprintf(stream, "Unknown error.\n");
+        break;
+    case DESC_E_OOM:
+        fprintf(stream, "Out of memory.\n");
         break;
-    case E_OOM:
-        fprintf(stderr, "Out of memory.\n");
+    case DESC_E_UNKNOWN_TOKEN:
+        fprintf(stream, "Unknown token:\n");
+        print_error_position(self, stream);
         break;
-    case E_UNKNOWN_TOKEN:
-        fprintf(stderr, "Unknown token:\n");
-        print_error_position();
+    case DESC_E_UNEXPECTED_TOKEN:
+        fprintf(stream, "Unexpected token: '%s'.\n",
+                jslex_tokstr(self->lexer.current_token.type));
+        print_expected(self, stream);
+        print_error_position(self, stream);
         break;
-    case E_UNEXPECTED_TOKEN:
-        fprintf(stderr, "Unexpected token: '%s'.\n",
-                jslex_tokstr(lexer_.current_token.type));
-        print_expected();
-        print_error_position();
+    case DESC_E_INVALID_ATTRIBUTE:
+        fprintf(stream, "Invalid attribute:\n");
+        print_error_position(self, stream);
+        break;
+    case DESC_E_INVALID_NESTED_ARRAY:
+        fprintf(stream, "Only int, real and bool arrays can be nested:\n");
+        print_error_position(self, stream);
+        break;
+    case DESC_E_INVALID_ENUM:
+        fprintf(stream, "Enum values must be unique and enums cannot be arrays:\n");
+        print_error_position(self, stream);
+        break;
+    case DESC_E_INVALID_INLINE_STRING:
+        fprintf(stream, "Inline strings hold 1 to %d bytes and cannot be arrays:\n",
+                INLINE_STRING_MAX_LENGTH);
+        print_error_position(self, stream);
         break;
     default:
         abort();
         break;
     }
 }
-
@@ -18,8 +18,37 @@
 #ifndef DESC_PARSER_H_INCLUDED_
 #define DESC_PARSER_H_INCLUDED_
 
-struct obj* desc_parse(const char* input);
-void desc_print_error_report();
+#include <stdio.h>
+#include "jslex.h"
+
+#define DESC_PARSER_EXPECT_STACK_MAX_SIZE 128
+
+enum desc_parser_error {
+    DESC_E_UNKNOWN = 0,
+    DESC_E_OOM,
+    DESC_E_UNKNOWN_TOKEN,
+    DESC_E_UNEXPECTED_TOKEN,
+    DESC_E_INVALID_ATTRIBUTE,
+    DESC_E_INVALID_NESTED_ARRAY,
+    DESC_E_INVALID_ENUM,
+    DESC_E_INVALID_INLINE_STRING
+};
+
+/* All state of a single parse, so that several schemas can be parsed at the
+ * same time, each with its own context. After a failed parse the context
+ * describes the error until it is used again; the report refers to the input,
+ * which must be kept around until then.
+ */
+struct desc_parser {
+    struct jslex lexer;
+    struct jslex_token* token;
+    enum desc_parser_error error;
+    int expect_stack_index;
+    enum jslex_token_type expect_stack[DESC_PARSER_EXPECT_STACK_MAX_SIZE];
+};
+
+struct obj* desc_parse(struct desc_parser* self, const char* input);
+void desc_print_error_report(const struct desc_parser* self, FILE* stream);
 
 #endif /*  DESC_PARSER_H_INCLUDED_ */
 
@@ -0,0 +1,127 @@
+/*
+ * Copyright (c) 2015, Marel hf
+ * Copyright (c) 2015, Andri Yngvason
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+ * REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+ * INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+ * OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/* Compiles templates to Lua bytecode at build time and writes them out as C
+ * arrays, which are linked into jsoncc as the default templates:
+ *
+ *     embed_templates [--source] templates/c_source.lua ... >src/templates.c
+ *
+ * Bytecode only loads on machines with the same word size and byte order as
+ * the one it was compiled on, so cross builds pass --source to embed the
+ * template text instead. It is still checked for syntax errors here.
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <stdio.h>
+#include <string.h>
+
+#include <lua.h>
+#include <lualib.h>
+#include <lauxlib.h>
+
+static int write_bytes(lua_State* L, const void* data, size_t size, void* ud)
+{
+    const unsigned char* bytes = data;
+    size_t* column = ud;
+    size_t i;
+
+    for(i = 0; i < size; ++i)
+    {
+        printf("%s0x%02x,", *column % 12 == 0 ? "\n    " : " ", bytes[i]);
+        ++*column;
+    }
+
+    return 0;
+}
+
+static int write_file(lua_State* L, const char* path, size_t* column)
+{
+    char chunk[4096];
+    size_t size;
+
+    FILE* file = fopen(path, "r");
+    if(!file)
+        return -1;
+
+    while((size = fread(chunk, 1, sizeof(chunk), file)) > 0)
+        write_bytes(L, chunk, size, column);
+
+    int r = ferror(file) ? -1 : 0;
+    fclose(file);
+    return r;
+}
+
+int main(int argc, char* argv[])
+{
+    int first = 1;
+    int is_source = 0;
+    if(argc > 1 && strcmp(argv[1], "--source") == 0)
+    {
+        is_source = 1;
+        first = 2;
+    }
+
+    lua_State* L = luaL_newstate();
+    if(!L)
+        return 1;
+
+    printf("/* Generated by embed_templates */\n\n");
+    printf("#include \"templates.h\"\n\n");
+
+    int i;
+    for(i = first; i < argc; ++i)
+    {
+        if(luaL_loadfile(L, argv[i]) != 0)
+        {
+            fprintf(stderr, "Compiling template failed: %s\n",
+                    lua_tostring(L, -1));
+            lua_close(L);
+            return 1;
+        }
+
+        size_t column = 0;
+        printf("static const unsigned char template_%d[] = {", i);
+        if(is_source)
+        {
+            if(write_file(L, argv[i], &column) < 0)
+            {
+                fprintf(stderr, "Reading template '%s' failed\n", argv[i]);
+                lua_close(L);
+                return 1;
+            }
+        }
+        else
+        {
+            lua_dump(L, write_bytes, &column);
+        }
+        printf("\n};\n\n");
+
+        lua_pop(L, 1);
+    }
+
+    printf("const struct embedded_template embedded_templates[] = {\n");
+    for(i = first; i < argc; ++i)
+        printf("    { \"%s\", template_%d, sizeof(template_%d) },\n",
+               basename(argv[i]), i, i);
+    printf("    { NULL, NULL, 0 }\n};\n");
+
+    lua_close(L);
+    return 0;
+}
@@ -21,11 +21,16 @@
 #include <ctype.h>
 #include <errno.h>
 #include <assert.h>
+#include <math.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 #include "jslex.h"
+#include "json_string.h"
 
-__attribute__((visibility("default")))
-int jslex_init(struct jslex* self, const char* input)
+static void jslex_start(struct jslex* self, const char* input)
 {
     memset(self, 0, sizeof(*self));
 
@@ -35,8 +40,16 @@ int jslex_init(struct jslex* self, const char* input)
     self->current_line = 1;
     self->line_start = input;
 
+    self->end = input + strlen(input);
+}
+
+__attribute__((visibility("default")))
+int jslex_init(struct jslex* self, const char* input)
+{
+    jslex_start(self, input);
+
     /* TODO: Make buffer dynamic? */
-    self->buffer_size = strlen(input) + 1;
+    self->buffer_size = self->end - input + 1;
     self->buffer = malloc(self->buffer_size);
     if(!self->buffer)
         return -1;
@@ -44,6 +57,31 @@ int jslex_init(struct jslex* self, const char* input)
     return 0;
 }
 
+/* Like jslex_init(), but the string buffer is owned by the caller and only
+ * grown when the input does not fit. jslex_cleanup() must not be called on
+ * such a lexer; the caller frees *buffer once it is done with it. */
+__attribute__((visibility("default")))
+int jslex_init_reuse(struct jslex* self, const char* input, char** buffer, size_t* buffer_size)
+{
+    jslex_start(self, input);
+
+    size_t size = self->end - input + 1;
+    if(size > *buffer_size)
+    {
+        char* grown = realloc(*buffer, size);
+        if(!grown)
+            return -1;
+
+        *buffer = grown;
+        *buffer_size = size;
+    }
+
+    self->buffer = *buffer;
+    self->buffer_size = *buffer_size;
+
+    return 0;
+}
+
 __attribute__((visibility("default")))
 void jslex_cleanup(struct jslex* self)
 {
@@ -94,6 +132,21 @@ void copy_literal(struct jslex* self)
     self->current_token.value.str = self->buffer;
 }
 
+/* Positive integers which do not fit in a long long are still exact as
+ * unsigned long long up to UINT64_MAX.
+ */
+static void classify_big_integer(struct jslex* self, size_t real_len)
+{
+    char* endptr = 0;
+    errno = 0;
+    unsigned long long value = strtoull(self->pos, &endptr, 10);
+    if(errno || (size_t)(endptr - self->pos) != real_len)
+        return;
+
+    self->current_token.big_integer = value;
+    self->errno_ = 0;
+}
+
 int classify_number(struct jslex* self)
 {
     double real;
@@ -105,6 +158,9 @@ int classify_number(struct jslex* self)
     errno = 0;
     endptr = 0;
     real = strtod(self->pos, &endptr);
+    /* Subnormal results set ERANGE too, but are exact enough to keep */
+    if(errno == ERANGE && isfinite(real) && real != 0)
+        errno = 0;
     real_len = errno ? 0 : endptr - self->pos;
     if(errno)
         self->errno_ = errno;
@@ -119,11 +175,16 @@ int classify_number(struct jslex* self)
     if(real_len == 0 && integer_len == 0)
         return -1;
 
+    self->current_token.big_integer = 0;
+
     if(real_len > integer_len)
     {
         self->current_token.type = JSLEX_REAL;
         self->current_token.value.real = real;
         self->next_pos = self->pos + real_len;
+
+        if(integer_len == 0 && *self->pos != '-')
+            classify_big_integer(self, real_len);
     }
     else
     {
@@ -135,77 +196,144 @@ int classify_number(struct jslex* self)
     return 0;
 }
 
+/* Characters in strings which take more than copying. Bytes from 0x80 up
+ * are only looked at when validating UTF-8.
+ */
+static inline int is_special(unsigned char c, int validate_utf8)
+{
+    return c == '"' || c == '\\' || c == '\n' || (validate_utf8 && c >= 0x80);
+}
+
+static size_t find_special(const char* src, const char* end, int validate_utf8)
+{
+    size_t len = end - src;
+    size_t i = 0;
+
+#ifdef __SSE2__
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i newline = _mm_set1_epi8('\n');
+
+    for(; i + 16 <= len; i += 16)
+    {
+        __m128i chunk = _mm_loadu_si128((const __m128i*)&src[i]);
+        __m128i special = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(chunk, quote),
+                         _mm_cmpeq_epi8(chunk, backslash)),
+            _mm_cmpeq_epi8(chunk, newline));
+
+        /* The top bit of each byte is set exactly for non-ASCII bytes */
+        int mask = _mm_movemask_epi8(special);
+        if(validate_utf8)
+            mask |= _mm_movemask_epi8(chunk);
+
+        if(mask)
+            return i + __builtin_ctz(mask);
+    }
+#endif
+
+    for(; i < len; ++i)
+        if(is_special(src[i], validate_utf8))
+            break;
+
+    return i;
+}
+
+/* Decodes the escape sequence after the backslash at 'src' */
+static int copy_escape(char** dst, const char** src, const char* end)
+{
+    const char* pos = *src + 1;
+    size_t consumed = 1;
+    char c;
+
+    if(pos >= end)
+        return -1;
+
+    switch(*pos)
+    {
+    case '"':  c = '"'; break;
+    case '\\': c = '\\'; break;
+    case '/':  c = '/'; break;
+    case 'n':  c = '\n'; break;
+    case 't':  c = '\t'; break;
+    case 'b':  c = '\b'; break;
+    case 'f':  c = '\f'; break;
+    case 'r':  c = '\r'; break;
+    case 'u':
+        {
+            ssize_t length = json_string_decode_unicode(*dst, pos + 1,
+                                                        end - pos - 1,
+                                                        &consumed);
+            if(length < 0)
+                return -1;
+
+            *dst += length;
+            *src = pos + 1 + consumed;
+            return 0;
+        }
+    default:
+        return -1;
+    }
+
+    *(*dst)++ = c;
+    *src = pos + consumed;
+    return 0;
+}
+
 int classify_string(struct jslex* self)
 {
     assert(*self->pos == '"');
 
     char* dst = self->buffer;
-    const char* src = self->pos;
+    const char* src = self->pos + 1;
+    const char* end = self->end;
 
-    int is_escaped = 0;
-
-    int i;
-    for(i = 1; src[i]; ++i)
+    while(src < end)
     {
-        if(is_escaped)
+        size_t run = find_special(src, end, self->validate_utf8);
+        memcpy(dst, src, run);
+        dst += run;
+        src += run;
+
+        if(src == end)
+            break;
+
+        size_t length;
+
+        switch(*src)
         {
-            switch(src[i])
-            {
-            case '"':
-                *dst++ = '"';
-                break;
-            case '\\':
-                *dst++ = '\\';
-                break;
-            case 'n':
-                *dst++ = '\n';
-                break;
-            case 't':
-                *dst++ = '\t';
-                break;
-            case 'b':
-                *dst++ = '\b';
-                break;
-            case 'f':
-                *dst++ = '\f';
-                break;
-            case 'r':
-                *dst++ = '\r';
-                break;
-            default:
+        case '"':
+            goto done;
+        case '\\':
+            if(copy_escape(&dst, &src, end) < 0)
+                goto error;
+            break;
+        case '\n':
+            self->line_start = src + 1;
+            self->current_line++;
+            *dst++ = *src++;
+            break;
+        default:
+            length = json_string_utf8_length(src, end - src);
+            if(length == 0)
                 goto error;
-            }
 
-            is_escaped = 0;
-        }
-        else
-        {
-            switch(src[i])
-            {
-            case '"':
-                goto done;
-            case '\\':
-                is_escaped = 1;
-                break;
-            case '\n':
-                self->line_start = &src[i+1];
-                self->current_line++;
-            default:
-                *dst++ = src[i];
-                break;
-            }
+            memcpy(dst, src, length);
+            dst += length;
+            src += length;
+            break;
         }
     }
 
 error:
-    self->pos += i;
+    self->pos = src;
     return -1;
 
 done:
     *dst = 0;
     self->current_token.type = JSLEX_STRING;
     self->current_token.value.str = self->buffer;
-    self->next_pos = self->pos + i + 1;
+    self->next_pos = src + 1;
 
     return 0;
 }
@@ -19,6 +19,9 @@
 #define JSLEX_H_INCLUDED_
 
 #include <stdlib.h>
+#include "json_tape.h"
+
+struct json_intern;
 
 enum jslex_token_type {
     JSLEX_LITERAL,
@@ -49,11 +52,15 @@ struct jslex_token {
         long long integer;
         double real;
     } value;
+    /* Integers above INT64_MAX are reals, but their exact value is kept here
+     * for unsigned 64 bit members. It is 0 for all other reals. */
+    unsigned long long big_integer;
 };
 
 struct jslex {
     struct jslex_token current_token;
     const char* input;
+    const char* end; /* the terminating null byte */
     const char* pos;
     const char* next_pos;
     const char* line_start;
@@ -62,16 +69,8 @@ struct jslex {
     size_t buffer_size;
     int accepted;
     int errno_;
-};
-
-enum json_obj_type {
-    JSON_OBJ_NULL = 0,
-    JSON_OBJ_OBJECT,
-    JSON_OBJ_ARRAY,
-    JSON_OBJ_REAL,
-    JSON_OBJ_INTEGER,
-    JSON_OBJ_STRING,
-    JSON_OBJ_BOOL
+    struct json_intern* intern; /* for interned string members */
+    int validate_utf8; /* reject strings which are not valid UTF-8 */
 };
 
 struct json_obj_any {
@@ -79,10 +78,16 @@ struct json_obj_any {
     long long integer;
     double real;
     char* string_;
+    size_t reserved_size_of_string_; /* kept across reuse, freed on cleanup */
     int boolean;
+    struct json_tape tape; /* objects and arrays */
 };
 
+/* Columnar object arrays keep one presence bit per row for each column */
+#define JSON_COLUMN_IS_SET(bitmap, row) (((bitmap)[(row) / 8] >> ((row) % 8)) & 1)
+
 int jslex_init(struct jslex* self, const char* input);
+int jslex_init_reuse(struct jslex* self, const char* input, char** buffer, size_t* buffer_size);
 void jslex_cleanup(struct jslex* self);
 
 struct jslex_token* jslex_next_token(struct jslex* self);
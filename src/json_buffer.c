@@ -0,0 +1,340 @@
+/*
+ * Copyright (c) 2015, Marel hf
+ * Copyright (c) 2015, Andri Yngvason
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+ * REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+ * INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+ * OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ */
+#include <errno.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "json_buffer.h"
+#include "json_format.h"
+#include "json_string.h"
+
+__attribute__((visibility("default")))
+int json_buffer_init(struct json_buffer* self, size_t size)
+{
+    memset(self, 0, sizeof(*self));
+
+    self->data = malloc(size + 1);
+    if(!self->data)
+        return -1;
+
+    self->data[0] = '\0';
+    self->reserved_size = size + 1;
+    return 0;
+}
+
+__attribute__((visibility("default")))
+void json_buffer_init_fixed(struct json_buffer* self, char* data, size_t size)
+{
+    memset(self, 0, sizeof(*self));
+
+    self->data = data;
+    self->reserved_size = size;
+    self->is_fixed = 1;
+
+    if(size > 0)
+        data[0] = '\0';
+}
+
+__attribute__((visibility("default")))
+int json_buffer_init_stream(struct json_buffer* self, size_t size,
+                            int (*write)(void* ctx, const struct iovec* iov,
+                                         int count),
+                            void* ctx)
+{
+    if(json_buffer_init(self, size) < 0)
+        return -1;
+
+    self->write = write;
+    self->ctx = ctx;
+    return 0;
+}
+
+__attribute__((visibility("default")))
+int json_buffer_flush(struct json_buffer* self)
+{
+    if(!self->write || self->length == 0)
+        return 0;
+
+    struct iovec iov = { self->data, self->length };
+    if(self->write(self->ctx, &iov, 1) < 0)
+        return -1;
+
+    self->flushed += self->length;
+    self->length = 0;
+    self->data[0] = '\0';
+    return 0;
+}
+
+__attribute__((visibility("default")))
+void json_buffer_cleanup(struct json_buffer* self)
+{
+    if(!self->is_fixed)
+        free(self->data);
+
+    memset(self, 0, sizeof(*self));
+}
+
+__attribute__((visibility("default")))
+int json_buffer_reserve(struct json_buffer* self, size_t size)
+{
+    if(self->length < self->reserved_size
+       && self->reserved_size - self->length > size)
+        return 0;
+
+    if(self->is_fixed)
+        return -1;
+
+    if(self->write)
+    {
+        if(json_buffer_flush(self) < 0)
+            return -1;
+
+        return self->reserved_size > size ? 0 : -1;
+    }
+
+    size_t new_size = self->reserved_size * 2;
+    if(new_size < self->length + size + 1)
+        new_size = self->length + size + 1;
+
+    char* data = realloc(self->data, new_size);
+    if(!data)
+        return -1;
+
+    self->data = data;
+    self->reserved_size = new_size;
+    return 0;
+}
+
+static int write_through(struct json_buffer* self, const char* data,
+                         size_t size)
+{
+    struct iovec iov[2] = {
+        { self->data, self->length },
+        { (void*)data, size }
+    };
+
+    if(self->write(self->ctx, iov, 2) < 0)
+        return -1;
+
+    self->flushed += self->length + size;
+    self->length = 0;
+    self->data[0] = '\0';
+    return 0;
+}
+
+__attribute__((visibility("default")))
+int json_buffer_append(struct json_buffer* self, const char* data, size_t size)
+{
+    if(self->write && size >= self->reserved_size / 2
+       && self->reserved_size - self->length <= size)
+        return write_through(self, data, size);
+
+    if(json_buffer_reserve(self, size) < 0)
+    {
+        if(!self->is_fixed)
+            return -1;
+
+        self->length += size;
+        return 0;
+    }
+
+    memcpy(&self->data[self->length], data, size);
+    self->length += size;
+    self->data[self->length] = '\0';
+    return 0;
+}
+
+__attribute__((visibility("default")))
+int json_buffer_printf(struct json_buffer* self, const char* fmt, ...)
+{
+    char* dst = NULL;
+    size_t room = 0;
+    va_list ap;
+
+    if(self->length < self->reserved_size)
+    {
+        dst = &self->data[self->length];
+        room = self->reserved_size - self->length;
+    }
+
+    va_start(ap, fmt);
+    int size = vsnprintf(dst, room, fmt, ap);
+    va_end(ap);
+
+    if(size < 0)
+        return -1;
+
+    /* The output was truncated, so it is written again after growing */
+    if((size_t)size >= room && !self->is_fixed)
+    {
+        if(json_buffer_reserve(self, size) < 0)
+            return -1;
+
+        va_start(ap, fmt);
+        vsnprintf(&self->data[self->length], size + 1, fmt, ap);
+        va_end(ap);
+    }
+
+    self->length += size;
+    return 0;
+}
+
+static inline int is_json_space(char c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+__attribute__((visibility("default")))
+int json_buffer_append_json(struct json_buffer* self, const char* json,
+                            size_t size)
+{
+    if(!self->is_compact)
+        return json_buffer_append(self, json, size);
+
+    /* Runs between whitespace are copied as they are */
+    size_t start = 0;
+    int is_string = 0;
+    size_t i;
+    for(i = 0; i < size; ++i)
+    {
+        if(is_string)
+        {
+            if(json[i] == '\\')
+                ++i;
+            else if(json[i] == '"')
+                is_string = 0;
+        }
+        else if(json[i] == '"')
+        {
+            is_string = 1;
+        }
+        else if(is_json_space(json[i]))
+        {
+            if(i > start && json_buffer_append(self, &json[start],
+                                               i - start) < 0)
+                return -1;
+            start = i + 1;
+        }
+    }
+
+    if(size > start)
+        return json_buffer_append(self, &json[start], size - start);
+
+    return 0;
+}
+
+__attribute__((visibility("default")))
+int json_buffer_append_string(struct json_buffer* self, const char* str,
+                              size_t len)
+{
+    if(json_buffer_append(self, "\"", 1) < 0)
+        return -1;
+
+    while(len > 0)
+    {
+        size_t run = json_string_find_escape(str, len);
+        if(json_buffer_append(self, str, run) < 0)
+            return -1;
+
+        if(run == len)
+            break;
+
+        char escape[6];
+        if(json_buffer_append(self, escape, json_string_escape(escape, str[run])) < 0)
+            return -1;
+
+        str += run + 1;
+        len -= run + 1;
+    }
+
+    return json_buffer_append(self, "\"", 1);
+}
+
+__attribute__((visibility("default")))
+int json_buffer_append_integer(struct json_buffer* self, long long value)
+{
+    char str[JSON_FORMAT_INTEGER_SIZE];
+    return json_buffer_append(self, str, json_format_integer(str, value));
+}
+
+__attribute__((visibility("default")))
+int json_buffer_append_unsigned(struct json_buffer* self,
+                                unsigned long long value)
+{
+    char str[JSON_FORMAT_INTEGER_SIZE];
+    return json_buffer_append(self, str, json_format_unsigned(str, value));
+}
+
+__attribute__((visibility("default")))
+int json_buffer_append_real(struct json_buffer* self, double value)
+{
+    char str[JSON_FORMAT_REAL_SIZE];
+    return json_buffer_append(self, str, json_format_real(str, value));
+}
+
+__attribute__((visibility("default")))
+int json_buffer_append_float(struct json_buffer* self, float value)
+{
+    char str[JSON_FORMAT_REAL_SIZE];
+    return json_buffer_append(self, str, json_format_float(str, value));
+}
+
+__attribute__((visibility("default")))
+int json_buffer_write_fd(void* ctx, const struct iovec* iov, int count)
+{
+    int fd = *(int*)ctx;
+    struct iovec rest[count];
+    memcpy(rest, iov, count * sizeof(*iov));
+
+    struct iovec* next = rest;
+    while(count > 0)
+    {
+        ssize_t size = writev(fd, next, count);
+        if(size < 0)
+        {
+            if(errno == EINTR)
+                continue;
+            return -1;
+        }
+
+        /* Skip whatever was written and retry the rest */
+        while(count > 0 && (size_t)size >= next->iov_len)
+        {
+            size -= next->iov_len;
+            ++next;
+            --count;
+        }
+
+        if(count > 0)
+        {
+            next->iov_base = (char*)next->iov_base + size;
+            next->iov_len -= size;
+        }
+    }
+
+    return 0;
+}
+
+__attribute__((visibility("default")))
+char* json_buffer_release(struct json_buffer* self)
+{
+    char* data = self->data;
+    memset(self, 0, sizeof(*self));
+    return data;
+}
@@ -0,0 +1,117 @@
+/*
+ * Copyright (c) 2015, Marel hf
+ * Copyright (c) 2015, Andri Yngvason
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+ * REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+ * INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+ * OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ */
+#ifndef JSON_BUFFER_H_INCLUDED_
+#define JSON_BUFFER_H_INCLUDED_
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/uio.h>
+
+/* Size of the buffer used by the generated stream pack functions */
+#define JSON_BUFFER_STREAM_SIZE 65536
+
+/* Largest initial size of the buffer of the generated pack_many functions,
+ * which grows from there as needed */
+#define JSON_BUFFER_MANY_SIZE (1 << 20)
+
+/* Output buffer of the generated pack functions. The data is always followed
+ * by a terminating null byte, which is not included in 'length'.
+ *
+ * A fixed buffer writes into memory owned by the caller and never grows.
+ * Output that does not fit is only counted, so 'length' is the size that
+ * would have been needed, and the data is complete only if 'length' is less
+ * than 'reserved_size'.
+ *
+ * A stream buffer does not grow either, but passes its data on to 'write'
+ * whenever it is full. Chunks larger than half the buffer are written
+ * together with the buffered data instead of being copied.
+ */
+struct json_buffer {
+    char* data;
+    size_t length;
+    size_t reserved_size;
+    int is_fixed;
+    int is_compact; /* json_buffer_append_json() drops whitespace */
+
+    /* Writes all of the vector, returning 0 on success or -1 on failure */
+    int (*write)(void* ctx, const struct iovec* iov, int count);
+    void* ctx;
+    size_t flushed;
+};
+
+int json_buffer_init(struct json_buffer* self, size_t size);
+void json_buffer_init_fixed(struct json_buffer* self, char* data, size_t size);
+int json_buffer_init_stream(struct json_buffer* self, size_t size,
+                            int (*write)(void* ctx, const struct iovec* iov,
+                                         int count),
+                            void* ctx);
+void json_buffer_cleanup(struct json_buffer* self);
+
+/* Makes room for at least 'size' more bytes. The buffer at least doubles
+ * each time it grows. Fails if a fixed buffer does not have the room.
+ */
+int json_buffer_reserve(struct json_buffer* self, size_t size);
+
+int json_buffer_append(struct json_buffer* self, const char* data, size_t size);
+/* For short text of a size known at compile time, such as the keys written
+ * by the generated code. The copy is inlined when the text fits.
+ */
+static inline int json_buffer_append_literal(struct json_buffer* self,
+                                             const char* data, size_t size)
+{
+    if(self->length + size >= self->reserved_size)
+        return json_buffer_append(self, data, size);
+
+    memcpy(&self->data[self->length], data, size);
+    self->length += size;
+    self->data[self->length] = '\0';
+    return 0;
+}
+
+int json_buffer_printf(struct json_buffer* self, const char* fmt, ...)
+    __attribute__((format(printf, 2, 3)));
+
+/* Appends a quoted json string. Runs of characters that need no escapes are
+ * copied as they are.
+ */
+int json_buffer_append_string(struct json_buffer* self, const char* str,
+                              size_t len);
+
+/* Appends text which already is valid json, such as an 'any' object or
+ * array. A compact buffer leaves out whitespace outside of strings, so
+ * newlines in the text do not split up newline delimited records.
+ */
+int json_buffer_append_json(struct json_buffer* self, const char* json,
+                            size_t size);
+
+/* Numbers are written by json_format_*() */
+int json_buffer_append_integer(struct json_buffer* self, long long value);
+int json_buffer_append_unsigned(struct json_buffer* self,
+                                unsigned long long value);
+int json_buffer_append_real(struct json_buffer* self, double value);
+int json_buffer_append_float(struct json_buffer* self, float value);
+
+/* Writes out the data of a stream buffer; does nothing for other buffers */
+int json_buffer_flush(struct json_buffer* self);
+
+/* A writer for stream buffers; 'ctx' points to a file descriptor */
+int json_buffer_write_fd(void* ctx, const struct iovec* iov, int count);
+
+/* Hands the data over to the caller, who must free it. */
+char* json_buffer_release(struct json_buffer* self);
+
+#endif /* JSON_BUFFER_H_INCLUDED_ */
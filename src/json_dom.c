@@ -0,0 +1,413 @@
+/*
+ * Copyright (c) 2015, Marel hf
+ * Copyright (c) 2015, Andri Yngvason
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+ * REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+ * INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+ * OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "json_dom.h"
+#include "json_string.h"
+
+enum dom_state {
+    DOM_FIRST, /* after '[' or '{' */
+    DOM_KEY,
+    DOM_VALUE,
+    DOM_AFTER_VALUE
+};
+
+static inline const char* skip_whitespace(const char* pos, const char* end)
+{
+    while(pos < end && (*pos == ' ' || *pos == '\n' || *pos == '\r'
+                                    || *pos == '\t'))
+        ++pos;
+
+    return pos;
+}
+
+/* Returns the position of the closing quote */
+static const char* scan_string(const char* pos, const char* end)
+{
+    for(++pos; pos < end; ++pos)
+    {
+        switch(*pos)
+        {
+        case '"':
+            return pos;
+        case '\\':
+            if(++pos == end)
+                return NULL;
+
+            if(*pos == 'u')
+            {
+                int i;
+                for(i = 0; i < 4; ++i)
+                    if(++pos == end || !isxdigit((unsigned char)*pos))
+                        return NULL;
+            }
+            else if(!strchr("\"\\/bfnrt", *pos))
+            {
+                return NULL;
+            }
+            break;
+        default:
+            if((unsigned char)*pos < 0x20)
+                return NULL;
+            break;
+        }
+    }
+
+    return NULL;
+}
+
+static const char* scan_digits(const char* pos, const char* end)
+{
+    const char* start = pos;
+
+    while(pos < end && isdigit((unsigned char)*pos))
+        ++pos;
+
+    return pos > start ? pos : NULL;
+}
+
+static const char* scan_number(const char* pos, const char* end,
+                               enum json_obj_type* type)
+{
+    *type = JSON_OBJ_INTEGER;
+
+    if(pos < end && *pos == '-')
+        ++pos;
+
+    if(pos < end && *pos == '0')
+        ++pos;
+    else if(!(pos = scan_digits(pos, end)))
+        return NULL;
+
+    if(pos < end && *pos == '.')
+    {
+        *type = JSON_OBJ_REAL;
+        if(!(pos = scan_digits(pos + 1, end)))
+            return NULL;
+    }
+
+    if(pos < end && (*pos == 'e' || *pos == 'E'))
+    {
+        *type = JSON_OBJ_REAL;
+        ++pos;
+        if(pos < end && (*pos == '+' || *pos == '-'))
+            ++pos;
+        if(!(pos = scan_digits(pos, end)))
+            return NULL;
+    }
+
+    return pos;
+}
+
+static const char* scan_literal(const char* pos, const char* end,
+                                const char* literal)
+{
+    size_t len = strlen(literal);
+
+    if((size_t)(end - pos) < len || 0 != memcmp(pos, literal, len))
+        return NULL;
+
+    return pos + len;
+}
+
+static const char* scan_scalar(struct json_dom_node* node, const char* pos,
+                               const char* end)
+{
+    switch(*pos)
+    {
+    case '"':
+        node->type = JSON_OBJ_STRING;
+        return scan_string(pos, end);
+    case 't':
+        node->type = JSON_OBJ_BOOL;
+        return scan_literal(pos, end, "true");
+    case 'f':
+        node->type = JSON_OBJ_BOOL;
+        return scan_literal(pos, end, "false");
+    case 'n':
+        node->type = JSON_OBJ_NULL;
+        return scan_literal(pos, end, "null");
+    default:
+        break;
+    }
+
+    return scan_number(pos, end, &node->type);
+}
+
+static int dom_grow(struct json_dom* self)
+{
+    if(self->length < self->reserved_size)
+        return 0;
+
+    if(self->reserved_size >= JSON_DOM_NONE / 2)
+        return -1;
+
+    uint32_t size = self->reserved_size ? self->reserved_size * 2 : 64;
+    struct json_dom_node* nodes = realloc(self->nodes, sizeof(*nodes) * size);
+    if(!nodes)
+        return -1;
+
+    self->nodes = nodes;
+    self->reserved_size = size;
+    return 0;
+}
+
+static inline char closing_char(const struct json_dom* self, uint32_t parent)
+{
+    return self->nodes[parent].type == JSON_OBJ_OBJECT ? '}' : ']';
+}
+
+static inline enum dom_state member_state(const struct json_dom* self,
+                                          uint32_t parent)
+{
+    return self->nodes[parent].type == JSON_OBJ_OBJECT ? DOM_KEY : DOM_VALUE;
+}
+
+/* Parses a complete document. The input is not copied, so it must outlive
+ * the nodes. Node storage is kept between calls.
+ */
+__attribute__((visibility("default")))
+int json_dom_parse(struct json_dom* self, const char* input, size_t length)
+{
+    const char* pos = input;
+    const char* end = input + length;
+    enum dom_state state = DOM_VALUE;
+    uint32_t parent = JSON_DOM_NONE;
+    struct json_span key = { JSON_DOM_NONE, 0 };
+
+    self->input = input;
+    self->length = 0;
+
+    if(length >= JSON_DOM_NONE)
+        return -1;
+
+    while(1)
+    {
+        pos = skip_whitespace(pos, end);
+
+        switch(state)
+        {
+        case DOM_FIRST:
+            if(pos < end && *pos == closing_char(self, parent))
+                break;
+
+            state = member_state(self, parent);
+            continue;
+        case DOM_KEY:
+        {
+            if(pos == end || *pos != '"')
+                return -1;
+
+            const char* quote = scan_string(pos, end);
+            if(!quote)
+                return -1;
+
+            key.start = pos + 1 - input;
+            key.length = quote - pos - 1;
+
+            pos = skip_whitespace(quote + 1, end);
+            if(pos == end || *pos != ':')
+                return -1;
+
+            ++pos;
+            state = DOM_VALUE;
+            continue;
+        }
+        case DOM_VALUE:
+        {
+            if(pos == end || dom_grow(self) < 0)
+                return -1;
+
+            uint32_t id = self->length++;
+            struct json_dom_node* node = &self->nodes[id];
+            node->parent = parent;
+            node->length = 0;
+            node->key = key;
+            node->value.start = pos - input;
+            key.start = JSON_DOM_NONE;
+            key.length = 0;
+
+            if(parent != JSON_DOM_NONE)
+                self->nodes[parent].length++;
+
+            if(*pos == '{' || *pos == '[')
+            {
+                node->type = *pos == '{' ? JSON_OBJ_OBJECT : JSON_OBJ_ARRAY;
+                parent = id;
+                ++pos;
+                state = DOM_FIRST;
+                continue;
+            }
+
+            const char* value_end = scan_scalar(node, pos, end);
+            if(!value_end)
+                return -1;
+
+            if(node->type == JSON_OBJ_STRING)
+            {
+                node->value.start++;
+                node->value.length = value_end - pos - 1;
+                pos = value_end + 1;
+            }
+            else
+            {
+                node->value.length = value_end - pos;
+                pos = value_end;
+            }
+
+            node->next = self->length;
+            state = DOM_AFTER_VALUE;
+            continue;
+        }
+        case DOM_AFTER_VALUE:
+            if(parent == JSON_DOM_NONE)
+                return pos == end ? 0 : -1;
+
+            if(pos < end && *pos == ',')
+            {
+                ++pos;
+                state = member_state(self, parent);
+                continue;
+            }
+
+            if(pos == end || *pos != closing_char(self, parent))
+                return -1;
+
+            break;
+        }
+
+        /* Close the innermost container */
+        struct json_dom_node* container = &self->nodes[parent];
+        container->next = self->length;
+        container->value.length = pos + 1 - input - container->value.start;
+        parent = container->parent;
+        ++pos;
+        state = DOM_AFTER_VALUE;
+    }
+}
+
+/* All nodes live in a single allocation */
+__attribute__((visibility("default")))
+void json_dom_cleanup(struct json_dom* self)
+{
+    free(self->nodes);
+    memset(self, 0, sizeof(*self));
+}
+
+__attribute__((visibility("default")))
+uint32_t json_dom_first_child(const struct json_dom* self, uint32_t id)
+{
+    return self->nodes[id].length > 0 ? id + 1 : JSON_DOM_NONE;
+}
+
+__attribute__((visibility("default")))
+uint32_t json_dom_next_sibling(const struct json_dom* self, uint32_t id)
+{
+    uint32_t parent = self->nodes[id].parent;
+    uint32_t next = self->nodes[id].next;
+
+    if(parent == JSON_DOM_NONE || next == self->nodes[parent].next)
+        return JSON_DOM_NONE;
+
+    return next;
+}
+
+/* Keys are compared as they appear in the input, without unescaping */
+__attribute__((visibility("default")))
+uint32_t json_dom_member(const struct json_dom* self, uint32_t id,
+                         const char* key)
+{
+    if(self->nodes[id].type != JSON_OBJ_OBJECT)
+        return JSON_DOM_NONE;
+
+    size_t len = strlen(key);
+
+    uint32_t child;
+    for(child = json_dom_first_child(self, id); child != JSON_DOM_NONE;
+        child = json_dom_next_sibling(self, child))
+    {
+        const struct json_span* span = &self->nodes[child].key;
+        if(span->length == len
+           && 0 == memcmp(&self->input[span->start], key, len))
+            return child;
+    }
+
+    return JSON_DOM_NONE;
+}
+
+/* Numbers are copied out of the input, which need not be terminated */
+static char* copy_value(const struct json_dom* self, uint32_t id,
+                        char* buffer, size_t size)
+{
+    const struct json_span* span = &self->nodes[id].value;
+
+    char* str = span->length < size ? buffer : malloc(span->length + 1);
+    if(!str)
+        return NULL;
+
+    memcpy(str, &self->input[span->start], span->length);
+    str[span->length] = 0;
+
+    return str;
+}
+
+__attribute__((visibility("default")))
+long long json_dom_integer(const struct json_dom* self, uint32_t id)
+{
+    char buffer[64];
+    char* str = copy_value(self, id, buffer, sizeof(buffer));
+    if(!str)
+        return 0;
+
+    long long value = strtoll(str, NULL, 10);
+
+    if(str != buffer)
+        free(str);
+
+    return value;
+}
+
+__attribute__((visibility("default")))
+double json_dom_real(const struct json_dom* self, uint32_t id)
+{
+    char buffer[64];
+    char* str = copy_value(self, id, buffer, sizeof(buffer));
+    if(!str)
+        return 0;
+
+    double value = strtod(str, NULL);
+
+    if(str != buffer)
+        free(str);
+
+    return value;
+}
+
+/* Returns the unescaped string, which must be freed by the caller */
+__attribute__((visibility("default")))
+char* json_dom_string(const struct json_dom* self, uint32_t id)
+{
+    const struct json_span* span = &self->nodes[id].value;
+
+    if(self->nodes[id].type != JSON_OBJ_STRING)
+        return NULL;
+
+    return json_string_decode(&self->input[span->start], span->length);
+}
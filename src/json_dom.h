@@ -0,0 +1,67 @@
+/*
+ * Copyright (c) 2015, Marel hf
+ * Copyright (c) 2015, Andri Yngvason
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+ * REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+ * INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+ * OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef JSON_DOM_H_INCLUDED_
+#define JSON_DOM_H_INCLUDED_
+
+#include <stdint.h>
+#include <stdlib.h>
+#include "json_tape.h"
+
+#define JSON_DOM_NONE UINT32_MAX
+
+/* Offsets into the parsed input */
+struct json_span {
+    uint32_t start;
+    uint32_t length;
+};
+
+/* Nodes are stored in document order and addressed by their index, so a
+ * node's children directly follow it and 'next' is the id of the node after
+ * its subtree. Strings and keys span their raw contents without the quotes,
+ * i.e. they may still contain escape sequences. Every other value spans its
+ * whole text, including the brackets of objects and arrays.
+ */
+struct json_dom_node {
+    enum json_obj_type type;
+    uint32_t parent;
+    uint32_t next;
+    uint32_t length; /* children of objects and arrays */
+    struct json_span key; /* start is JSON_DOM_NONE outside of objects */
+    struct json_span value;
+};
+
+struct json_dom {
+    const char* input;
+    struct json_dom_node* nodes;
+    uint32_t length;
+    uint32_t reserved_size;
+};
+
+int json_dom_parse(struct json_dom* self, const char* input, size_t length);
+void json_dom_cleanup(struct json_dom* self);
+
+uint32_t json_dom_first_child(const struct json_dom* self, uint32_t id);
+uint32_t json_dom_next_sibling(const struct json_dom* self, uint32_t id);
+uint32_t json_dom_member(const struct json_dom* self, uint32_t id,
+                         const char* key);
+
+long long json_dom_integer(const struct json_dom* self, uint32_t id);
+double json_dom_real(const struct json_dom* self, uint32_t id);
+char* json_dom_string(const struct json_dom* self, uint32_t id);
+
+#endif /* JSON_DOM_H_INCLUDED_ */
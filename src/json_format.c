@@ -0,0 +1,493 @@
+/*
+ * Copyright (c) 2015, Marel hf
+ * Copyright (c) 2015, Andri Yngvason
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+ * REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+ * INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+ * OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ */
+/* The reals are written with the Grisu2 algorithm by Florian Loitsch,
+ * "Printing Floating-Point Numbers Quickly and Accurately with Integers", 2010.
+ * The output always reads back as the same number, and is the shortest such
+ * number in the vast majority of cases.
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "json_format.h"
+
+static const char digit_pairs_[201] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+__attribute__((visibility("default")))
+size_t json_format_unsigned(char* dst, unsigned long long value)
+{
+    char str[JSON_FORMAT_INTEGER_SIZE];
+    char* end = str + sizeof(str);
+    char* p = end;
+
+    while(value >= 100)
+    {
+        unsigned int pair = (value % 100) * 2;
+        value /= 100;
+        p -= 2;
+        memcpy(p, &digit_pairs_[pair], 2);
+    }
+
+    if(value >= 10)
+    {
+        p -= 2;
+        memcpy(p, &digit_pairs_[value * 2], 2);
+    }
+    else
+    {
+        *--p = '0' + value;
+    }
+
+    memcpy(dst, p, end - p);
+    return end - p;
+}
+
+__attribute__((visibility("default")))
+size_t json_format_integer(char* dst, long long value)
+{
+    if(value >= 0)
+        return json_format_unsigned(dst, value);
+
+    *dst = '-';
+    return 1 + json_format_unsigned(dst + 1, 0ULL - (unsigned long long)value);
+}
+
+/* f * 2^e */
+struct diy_fp {
+    uint64_t f;
+    int e;
+};
+
+/* Normalized powers of ten from 1e-348 to 1e340 in steps of 8 */
+static const struct diy_fp cached_powers_[] = {
+    { 0xfa8fd5a0081c0288ULL, -1220 }, /* 1e-348 */
+    { 0xbaaee17fa23ebf76ULL, -1193 }, /* 1e-340 */
+    { 0x8b16fb203055ac76ULL, -1166 }, /* 1e-332 */
+    { 0xcf42894a5dce35eaULL, -1140 }, /* 1e-324 */
+    { 0x9a6bb0aa55653b2dULL, -1113 }, /* 1e-316 */
+    { 0xe61acf033d1a45dfULL, -1087 }, /* 1e-308 */
+    { 0xab70fe17c79ac6caULL, -1060 }, /* 1e-300 */
+    { 0xff77b1fcbebcdc4fULL, -1034 }, /* 1e-292 */
+    { 0xbe5691ef416bd60cULL, -1007 }, /* 1e-284 */
+    { 0x8dd01fad907ffc3cULL,  -980 }, /* 1e-276 */
+    { 0xd3515c2831559a83ULL,  -954 }, /* 1e-268 */
+    { 0x9d71ac8fada6c9b5ULL,  -927 }, /* 1e-260 */
+    { 0xea9c227723ee8bcbULL,  -901 }, /* 1e-252 */
+    { 0xaecc49914078536dULL,  -874 }, /* 1e-244 */
+    { 0x823c12795db6ce57ULL,  -847 }, /* 1e-236 */
+    { 0xc21094364dfb5637ULL,  -821 }, /* 1e-228 */
+    { 0x9096ea6f3848984fULL,  -794 }, /* 1e-220 */
+    { 0xd77485cb25823ac7ULL,  -768 }, /* 1e-212 */
+    { 0xa086cfcd97bf97f4ULL,  -741 }, /* 1e-204 */
+    { 0xef340a98172aace5ULL,  -715 }, /* 1e-196 */
+    { 0xb23867fb2a35b28eULL,  -688 }, /* 1e-188 */
+    { 0x84c8d4dfd2c63f3bULL,  -661 }, /* 1e-180 */
+    { 0xc5dd44271ad3cdbaULL,  -635 }, /* 1e-172 */
+    { 0x936b9fcebb25c996ULL,  -608 }, /* 1e-164 */
+    { 0xdbac6c247d62a584ULL,  -582 }, /* 1e-156 */
+    { 0xa3ab66580d5fdaf6ULL,  -555 }, /* 1e-148 */
+    { 0xf3e2f893dec3f126ULL,  -529 }, /* 1e-140 */
+    { 0xb5b5ada8aaff80b8ULL,  -502 }, /* 1e-132 */
+    { 0x87625f056c7c4a8bULL,  -475 }, /* 1e-124 */
+    { 0xc9bcff6034c13053ULL,  -449 }, /* 1e-116 */
+    { 0x964e858c91ba2655ULL,  -422 }, /* 1e-108 */
+    { 0xdff9772470297ebdULL,  -396 }, /* 1e-100 */
+    { 0xa6dfbd9fb8e5b88fULL,  -369 }, /* 1e-92 */
+    { 0xf8a95fcf88747d94ULL,  -343 }, /* 1e-84 */
+    { 0xb94470938fa89bcfULL,  -316 }, /* 1e-76 */
+    { 0x8a08f0f8bf0f156bULL,  -289 }, /* 1e-68 */
+    { 0xcdb02555653131b6ULL,  -263 }, /* 1e-60 */
+    { 0x993fe2c6d07b7facULL,  -236 }, /* 1e-52 */
+    { 0xe45c10c42a2b3b06ULL,  -210 }, /* 1e-44 */
+    { 0xaa242499697392d3ULL,  -183 }, /* 1e-36 */
+    { 0xfd87b5f28300ca0eULL,  -157 }, /* 1e-28 */
+    { 0xbce5086492111aebULL,  -130 }, /* 1e-20 */
+    { 0x8cbccc096f5088ccULL,  -103 }, /* 1e-12 */
+    { 0xd1b71758e219652cULL,   -77 }, /* 1e-4 */
+    { 0x9c40000000000000ULL,   -50 }, /* 1e4 */
+    { 0xe8d4a51000000000ULL,   -24 }, /* 1e12 */
+    { 0xad78ebc5ac620000ULL,     3 }, /* 1e20 */
+    { 0x813f3978f8940984ULL,    30 }, /* 1e28 */
+    { 0xc097ce7bc90715b3ULL,    56 }, /* 1e36 */
+    { 0x8f7e32ce7bea5c70ULL,    83 }, /* 1e44 */
+    { 0xd5d238a4abe98068ULL,   109 }, /* 1e52 */
+    { 0x9f4f2726179a2245ULL,   136 }, /* 1e60 */
+    { 0xed63a231d4c4fb27ULL,   162 }, /* 1e68 */
+    { 0xb0de65388cc8ada8ULL,   189 }, /* 1e76 */
+    { 0x83c7088e1aab65dbULL,   216 }, /* 1e84 */
+    { 0xc45d1df942711d9aULL,   242 }, /* 1e92 */
+    { 0x924d692ca61be758ULL,   269 }, /* 1e100 */
+    { 0xda01ee641a708deaULL,   295 }, /* 1e108 */
+    { 0xa26da3999aef774aULL,   322 }, /* 1e116 */
+    { 0xf209787bb47d6b85ULL,   348 }, /* 1e124 */
+    { 0xb454e4a179dd1877ULL,   375 }, /* 1e132 */
+    { 0x865b86925b9bc5c2ULL,   402 }, /* 1e140 */
+    { 0xc83553c5c8965d3dULL,   428 }, /* 1e148 */
+    { 0x952ab45cfa97a0b3ULL,   455 }, /* 1e156 */
+    { 0xde469fbd99a05fe3ULL,   481 }, /* 1e164 */
+    { 0xa59bc234db398c25ULL,   508 }, /* 1e172 */
+    { 0xf6c69a72a3989f5cULL,   534 }, /* 1e180 */
+    { 0xb7dcbf5354e9beceULL,   561 }, /* 1e188 */
+    { 0x88fcf317f22241e2ULL,   588 }, /* 1e196 */
+    { 0xcc20ce9bd35c78a5ULL,   614 }, /* 1e204 */
+    { 0x98165af37b2153dfULL,   641 }, /* 1e212 */
+    { 0xe2a0b5dc971f303aULL,   667 }, /* 1e220 */
+    { 0xa8d9d1535ce3b396ULL,   694 }, /* 1e228 */
+    { 0xfb9b7cd9a4a7443cULL,   720 }, /* 1e236 */
+    { 0xbb764c4ca7a44410ULL,   747 }, /* 1e244 */
+    { 0x8bab8eefb6409c1aULL,   774 }, /* 1e252 */
+    { 0xd01fef10a657842cULL,   800 }, /* 1e260 */
+    { 0x9b10a4e5e9913129ULL,   827 }, /* 1e268 */
+    { 0xe7109bfba19c0c9dULL,   853 }, /* 1e276 */
+    { 0xac2820d9623bf429ULL,   880 }, /* 1e284 */
+    { 0x80444b5e7aa7cf85ULL,   907 }, /* 1e292 */
+    { 0xbf21e44003acdd2dULL,   933 }, /* 1e300 */
+    { 0x8e679c2f5e44ff8fULL,   960 }, /* 1e308 */
+    { 0xd433179d9c8cb841ULL,   986 }, /* 1e316 */
+    { 0x9e19db92b4e31ba9ULL,  1013 }, /* 1e324 */
+    { 0xeb96bf6ebadf77d9ULL,  1039 }, /* 1e332 */
+    { 0xaf87023b9bf0ee6bULL,  1066 }, /* 1e340 */
+};
+
+static struct diy_fp normalize(struct diy_fp x)
+{
+    int shift = __builtin_clzll(x.f);
+    x.f <<= shift;
+    x.e -= shift;
+    return x;
+}
+
+/* The upper 64 bits of the product, rounded */
+static struct diy_fp multiply(struct diy_fp x, struct diy_fp y)
+{
+    const uint64_t mask = 0xffffffffu;
+    uint64_t a = x.f >> 32, b = x.f & mask;
+    uint64_t c = y.f >> 32, d = y.f & mask;
+    uint64_t ac = a * c, bc = b * c, ad = a * d, bd = b * d;
+    uint64_t middle = (bd >> 32) + (ad & mask) + (bc & mask) + (1u << 31);
+
+    struct diy_fp res = {
+        ac + (ad >> 32) + (bc >> 32) + (middle >> 32),
+        x.e + y.e + 64
+    };
+    return res;
+}
+
+/* Picks c = 10^-k such that multiplying by it brings the binary exponent e
+ * into [-60, -32].
+ */
+static struct diy_fp cached_power(int e, int* k)
+{
+    double dk = (-61 - e) * 0.30102999566398114 + 347;
+    int ik = (int)dk;
+    if(dk - ik > 0.0)
+        ++ik;
+
+    unsigned int index = (ik >> 3) + 1;
+    *k = -(-348 + (int)index * 8);
+    return cached_powers_[index];
+}
+
+static const uint64_t powers_of_ten_[] = {
+    1ULL,
+    10ULL,
+    100ULL,
+    1000ULL,
+    10000ULL,
+    100000ULL,
+    1000000ULL,
+    10000000ULL,
+    100000000ULL,
+    1000000000ULL,
+    10000000000ULL,
+    100000000000ULL,
+    1000000000000ULL,
+    10000000000000ULL,
+    100000000000000ULL,
+    1000000000000000ULL,
+    10000000000000000ULL,
+    100000000000000000ULL,
+    1000000000000000000ULL,
+    10000000000000000000ULL
+};
+
+static int count_digits(uint32_t n)
+{
+    int digits = 1;
+    while(digits < 10 && n >= powers_of_ten_[digits])
+        ++digits;
+    return digits;
+}
+
+/* Moves the last digit closer to the real value while it stays in range */
+static void round_weed(char* digits, int length, uint64_t delta, uint64_t rest,
+                       uint64_t ten_kappa, uint64_t distance)
+{
+    while(rest < distance && delta - rest >= ten_kappa
+          && (rest + ten_kappa < distance
+              || distance - rest > rest + ten_kappa - distance))
+    {
+        digits[length - 1]--;
+        rest += ten_kappa;
+    }
+}
+
+static void generate_digits(struct diy_fp w, struct diy_fp upper,
+                            uint64_t delta, char* digits, int* length, int* k)
+{
+    const struct diy_fp one = { 1ULL << -upper.e, upper.e };
+    const uint64_t distance = upper.f - w.f;
+    uint32_t integral = (uint32_t)(upper.f >> -one.e);
+    uint64_t fraction = upper.f & (one.f - 1);
+    int kappa = count_digits(integral);
+
+    *length = 0;
+
+    while(kappa > 0)
+    {
+        uint32_t divisor = powers_of_ten_[kappa - 1];
+        uint32_t digit = integral / divisor;
+        integral %= divisor;
+
+        if(digit || *length)
+            digits[(*length)++] = '0' + digit;
+
+        --kappa;
+
+        uint64_t rest = ((uint64_t)integral << -one.e) + fraction;
+        if(rest <= delta)
+        {
+            *k += kappa;
+            round_weed(digits, *length, delta, rest,
+                       powers_of_ten_[kappa] << -one.e, distance);
+            return;
+        }
+    }
+
+    while(1)
+    {
+        fraction *= 10;
+        delta *= 10;
+
+        char digit = (char)(fraction >> -one.e);
+        if(digit || *length)
+            digits[(*length)++] = '0' + digit;
+
+        fraction &= one.f - 1;
+        --kappa;
+
+        if(fraction < delta)
+        {
+            *k += kappa;
+            int index = -kappa;
+            round_weed(digits, *length, delta, fraction, one.f,
+                       distance * (index < 20 ? powers_of_ten_[index] : 0));
+            return;
+        }
+    }
+}
+
+/* Finds the digits of f * 2^e, so that the value is digits * 10^k. The value
+ * may be anywhere between the midpoints to the neighbouring floating point
+ * numbers, and the lower neighbour is closer when the significand is a power
+ * of two.
+ */
+static void grisu2(uint64_t f, int e, int is_lower_closer, char* digits,
+                   int* length, int* k)
+{
+    struct diy_fp v = { f, e };
+    struct diy_fp upper = { (f << 1) + 1, e - 1 };
+    struct diy_fp lower = { (f << 1) - 1, e - 1 };
+
+    if(is_lower_closer)
+    {
+        lower.f = (f << 2) - 1;
+        lower.e = e - 2;
+    }
+
+    upper = normalize(upper);
+    lower.f <<= lower.e - upper.e;
+    lower.e = upper.e;
+
+    struct diy_fp c = cached_power(upper.e, k);
+    struct diy_fp w = multiply(normalize(v), c);
+    struct diy_fp w_upper = multiply(upper, c);
+    struct diy_fp w_lower = multiply(lower, c);
+
+    /* Stay clear of the boundaries, which are not exact after rounding */
+    w_lower.f++;
+    w_upper.f--;
+
+    generate_digits(w, w_upper, w_upper.f - w_lower.f, digits, length, k);
+}
+
+static size_t write_exponent(char* dst, int exponent)
+{
+    char* p = dst;
+
+    if(exponent < 0)
+    {
+        *p++ = '-';
+        exponent = -exponent;
+    }
+
+    return (p - dst) + json_format_unsigned(p, exponent);
+}
+
+/* Lays out digits * 10^k, which are already at the start of dst */
+static size_t prettify(char* dst, int length, int k)
+{
+    /* 10^(kk - 1) <= value < 10^kk */
+    const int kk = length + k;
+
+    if(k >= 0 && kk <= 21)
+    {
+        /* 1234e7 -> 12340000000.0 */
+        memset(&dst[length], '0', k);
+        dst[kk] = '.';
+        dst[kk + 1] = '0';
+        return kk + 2;
+    }
+
+    if(kk > 0 && kk <= 21)
+    {
+        /* 1234e-2 -> 12.34 */
+        memmove(&dst[kk + 1], &dst[kk], length - kk);
+        dst[kk] = '.';
+        return length + 1;
+    }
+
+    if(kk > -6 && kk <= 0)
+    {
+        /* 1234e-6 -> 0.001234 */
+        const int offset = 2 - kk;
+        memmove(&dst[offset], dst, length);
+        dst[0] = '0';
+        dst[1] = '.';
+        memset(&dst[2], '0', offset - 2);
+        return length + offset;
+    }
+
+    if(length == 1)
+    {
+        /* 1e30 */
+        dst[1] = 'e';
+        return 2 + write_exponent(&dst[2], kk - 1);
+    }
+
+    /* 1234e30 -> 1.234e33 */
+    memmove(&dst[2], &dst[1], length - 1);
+    dst[1] = '.';
+    dst[length + 1] = 'e';
+    return length + 2 + write_exponent(&dst[length + 2], kk - 1);
+}
+
+static size_t format_special(char* dst, int is_zero, int is_negative)
+{
+    if(!is_zero)
+    {
+        memcpy(dst, "null", 4);
+        return 4;
+    }
+
+    if(is_negative)
+    {
+        memcpy(dst, "-0.0", 4);
+        return 4;
+    }
+
+    memcpy(dst, "0.0", 3);
+    return 3;
+}
+
+__attribute__((visibility("default")))
+size_t json_format_real(char* dst, double value)
+{
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+
+    const int is_negative = bits >> 63;
+    const int biased_exponent = (bits >> 52) & 0x7ff;
+    uint64_t f = bits & 0xfffffffffffffULL;
+    int e;
+
+    if(biased_exponent == 0x7ff || (biased_exponent == 0 && f == 0))
+        return format_special(dst, biased_exponent == 0, is_negative);
+
+    if(biased_exponent != 0)
+    {
+        f += 1ULL << 52;
+        e = biased_exponent - 1075;
+    }
+    else
+    {
+        e = -1074;
+    }
+
+    char* p = dst;
+    if(is_negative)
+        *p++ = '-';
+
+    int length, k;
+    grisu2(f, e, f == 1ULL << 52 && biased_exponent > 1, p, &length, &k);
+
+    return (p - dst) + prettify(p, length, k);
+}
+
+__attribute__((visibility("default")))
+size_t json_format_float(char* dst, float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+
+    const int is_negative = bits >> 31;
+    const int biased_exponent = (bits >> 23) & 0xff;
+    uint64_t f = bits & 0x7fffff;
+    int e;
+
+    if(biased_exponent == 0xff || (biased_exponent == 0 && f == 0))
+        return format_special(dst, biased_exponent == 0, is_negative);
+
+    if(biased_exponent != 0)
+    {
+        f += 1 << 23;
+        e = biased_exponent - 150;
+    }
+    else
+    {
+        e = -149;
+    }
+
+    char* p = dst;
+    if(is_negative)
+        *p++ = '-';
+
+    int length, k;
+    grisu2(f, e, f == 1 << 23 && biased_exponent > 1, p, &length, &k);
+
+    return (p - dst) + prettify(p, length, k);
+}
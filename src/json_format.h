@@ -0,0 +1,40 @@
+/*
+ * Copyright (c) 2015, Marel hf
+ * Copyright (c) 2015, Andri Yngvason
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+ * REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+ * INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+ * OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ */
+#ifndef JSON_FORMAT_H_INCLUDED_
+#define JSON_FORMAT_H_INCLUDED_
+
+#include <stdlib.h>
+
+/* Buffer sizes that fit any output of the functions below */
+#define JSON_FORMAT_INTEGER_SIZE 24
+#define JSON_FORMAT_REAL_SIZE 32
+
+/* These write numbers as json without a terminating null byte, and return
+ * the number of bytes written. They do not depend on the locale.
+ */
+size_t json_format_integer(char* dst, long long value);
+size_t json_format_unsigned(char* dst, unsigned long long value);
+
+/* Writes the shortest number that reads back as exactly the same value.
+ * Reals always get a decimal point or an exponent, so that they are not taken
+ * for integers. Infinity and NaN have no json representation and are written
+ * as null.
+ */
+size_t json_format_real(char* dst, double value);
+size_t json_format_float(char* dst, float value);
+
+#endif /* JSON_FORMAT_H_INCLUDED_ */
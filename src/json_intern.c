@@ -0,0 +1,214 @@
+/*
+ * Copyright (c) 2015, Marel hf
+ * Copyright (c) 2015, Andri Yngvason
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+ * REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+ * INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+ * OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ */
+#include <string.h>
+
+#include "json_intern.h"
+
+#define BLOCK_SIZE 65536
+
+/* Strings are stored back to back in blocks, so they never move once they
+ * have been handed out.
+ */
+struct json_intern_block {
+    struct json_intern_block* next;
+    size_t length;
+    size_t reserved_size;
+    char data[];
+};
+
+static uint32_t hash_string(const char* str, size_t len)
+{
+    uint32_t hash = 2166136261u;
+    size_t i;
+
+    for(i = 0; i < len; ++i)
+    {
+        hash ^= (unsigned char)str[i];
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
+
+__attribute__((visibility("default")))
+int json_intern_init(struct json_intern* self)
+{
+    memset(self, 0, sizeof(*self));
+    return pthread_rwlock_init(&self->lock, NULL) == 0 ? 0 : -1;
+}
+
+__attribute__((visibility("default")))
+void json_intern_cleanup(struct json_intern* self)
+{
+    struct json_intern_block* block = self->blocks;
+    while(block)
+    {
+        struct json_intern_block* next = block->next;
+        free(block);
+        block = next;
+    }
+
+    free(self->slots);
+    pthread_rwlock_destroy(&self->lock);
+}
+
+static struct json_intern_slot* find_slot(struct json_intern_slot* slots,
+                                          size_t reserved_size,
+                                          const char* str, size_t len,
+                                          uint32_t hash)
+{
+    size_t mask = reserved_size - 1;
+    size_t i = hash & mask;
+
+    while(slots[i].str)
+    {
+        if(slots[i].hash == hash && slots[i].length == len
+           && memcmp(slots[i].str, str, len) == 0)
+            break;
+
+        i = (i + 1) & mask;
+    }
+
+    return &slots[i];
+}
+
+static const char* lookup(struct json_intern* self, const char* str,
+                          size_t len, uint32_t hash)
+{
+    if(!self->slots)
+        return NULL;
+
+    return find_slot(self->slots, self->reserved_size, str, len, hash)->str;
+}
+
+/* The table is kept at most half full. */
+static int grow(struct json_intern* self)
+{
+    if((self->length + 1) * 2 <= self->reserved_size)
+        return 0;
+
+    size_t size = self->reserved_size ? self->reserved_size * 2 : 64;
+    struct json_intern_slot* slots = calloc(size, sizeof(*slots));
+    if(!slots)
+        return -1;
+
+    size_t i;
+    for(i = 0; i < self->reserved_size; ++i)
+    {
+        const struct json_intern_slot* slot = &self->slots[i];
+        if(slot->str)
+            *find_slot(slots, size, slot->str, slot->length, slot->hash) = *slot;
+    }
+
+    free(self->slots);
+    self->slots = slots;
+    self->reserved_size = size;
+    return 0;
+}
+
+static char* store(struct json_intern* self, const char* str, size_t len)
+{
+    struct json_intern_block* block = self->blocks;
+
+    if(!block || block->reserved_size - block->length < len + 1)
+    {
+        size_t size = len + 1 > BLOCK_SIZE ? len + 1 : BLOCK_SIZE;
+        block = malloc(sizeof(*block) + size);
+        if(!block)
+            return NULL;
+
+        block->length = 0;
+        block->reserved_size = size;
+
+        /* Keep the partially filled block in front if the new one is a
+         * dedicated block for a long string.
+         */
+        if(self->blocks && size > BLOCK_SIZE)
+        {
+            block->next = self->blocks->next;
+            self->blocks->next = block;
+        }
+        else
+        {
+            block->next = self->blocks;
+            self->blocks = block;
+        }
+    }
+
+    char* res = &block->data[block->length];
+    memcpy(res, str, len);
+    res[len] = '\0';
+    block->length += len + 1;
+    return res;
+}
+
+static const char* insert(struct json_intern* self, const char* str,
+                          size_t len, uint32_t hash)
+{
+    /* Another thread may have added it while the lock was released */
+    const char* res = lookup(self, str, len, hash);
+    if(res)
+        return res;
+
+    if(grow(self) < 0)
+        return NULL;
+
+    char* copy = store(self, str, len);
+    if(!copy)
+        return NULL;
+
+    struct json_intern_slot* slot = find_slot(self->slots, self->reserved_size,
+                                              str, len, hash);
+    slot->str = copy;
+    slot->length = len;
+    slot->hash = hash;
+    self->length++;
+
+    return copy;
+}
+
+__attribute__((visibility("default")))
+const char* json_intern(struct json_intern* self, const char* str, size_t len)
+{
+    if(!self)
+        return NULL;
+
+    uint32_t hash = hash_string(str, len);
+
+    pthread_rwlock_rdlock(&self->lock);
+    const char* res = lookup(self, str, len, hash);
+    pthread_rwlock_unlock(&self->lock);
+
+    if(res)
+        return res;
+
+    pthread_rwlock_wrlock(&self->lock);
+    res = insert(self, str, len, hash);
+    pthread_rwlock_unlock(&self->lock);
+
+    return res;
+}
+
+__attribute__((visibility("default")))
+size_t json_intern_length(struct json_intern* self)
+{
+    pthread_rwlock_rdlock(&self->lock);
+    size_t length = self->length;
+    pthread_rwlock_unlock(&self->lock);
+
+    return length;
+}
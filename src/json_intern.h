@@ -0,0 +1,56 @@
+/*
+ * Copyright (c) 2015, Marel hf
+ * Copyright (c) 2015, Andri Yngvason
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+ * REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+ * INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+ * OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ */
+#ifndef JSON_INTERN_H_INCLUDED_
+#define JSON_INTERN_H_INCLUDED_
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <pthread.h>
+
+struct json_intern_slot {
+    const char* str;
+    size_t length;
+    uint32_t hash;
+};
+
+struct json_intern_block;
+
+/* A set of unique strings which may be shared between threads. Interned
+ * strings stay valid until the table is cleaned up, so two interned strings
+ * are equal exactly when their pointers are equal.
+ */
+struct json_intern {
+    pthread_rwlock_t lock;
+
+    struct json_intern_slot* slots;
+    size_t length;
+    size_t reserved_size; /* always a power of two */
+
+    struct json_intern_block* blocks;
+};
+
+int json_intern_init(struct json_intern* self);
+void json_intern_cleanup(struct json_intern* self);
+
+/* Returns the interned copy of 'str', or NULL if out of memory or if 'self' is
+ * NULL.
+ */
+const char* json_intern(struct json_intern* self, const char* str, size_t len);
+
+size_t json_intern_length(struct json_intern* self);
+
+#endif /* JSON_INTERN_H_INCLUDED_ */
@@ -0,0 +1,239 @@
+/*
+ * Copyright (c) 2015, Marel hf
+ * Copyright (c) 2015, Andri Yngvason
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+ * REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+ * INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+ * OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ */
+#include <string.h>
+
+#include "json_pool.h"
+
+struct json_pool_job {
+    const char* items;
+    size_t n;
+    size_t item_size;
+    size_t chunk_length;
+    int (*pack)(const void* item, struct json_buffer* out);
+    struct json_batch* batch;
+    int is_failed;
+};
+
+static int pack_chunk(const struct json_pool_job* job, size_t chunk)
+{
+    size_t begin = chunk * job->chunk_length;
+    size_t end = begin + job->chunk_length;
+    if(end > job->n)
+        end = job->n;
+
+    struct json_buffer* out = &job->batch->buffers[chunk];
+    if(json_buffer_init(out, 4096) < 0)
+        return -1;
+
+    size_t i;
+    for(i = begin; i < end; ++i)
+        if(job->pack(job->items + i * job->item_size, out) < 0)
+            return -1;
+
+    return 0;
+}
+
+/* Takes chunks of the current job until there are none left. Called with the
+ * lock held, which is released while packing.
+ */
+static void run_chunks(struct json_pool* self)
+{
+    struct json_pool_job* job = self->job;
+    size_t count = job->batch->count;
+
+    while(self->next_chunk < count)
+    {
+        size_t chunk = self->next_chunk++;
+
+        pthread_mutex_unlock(&self->lock);
+        int r = pack_chunk(job, chunk);
+        pthread_mutex_lock(&self->lock);
+
+        if(r < 0)
+            job->is_failed = 1;
+
+        if(++self->finished_chunks == count)
+            pthread_cond_broadcast(&self->done);
+    }
+}
+
+static void* worker(void* arg)
+{
+    struct json_pool* self = arg;
+
+    pthread_mutex_lock(&self->lock);
+
+    while(!self->is_stopping)
+    {
+        if(self->job && self->next_chunk < (size_t)self->job->batch->count)
+            run_chunks(self);
+        else
+            pthread_cond_wait(&self->work, &self->lock);
+    }
+
+    pthread_mutex_unlock(&self->lock);
+    return NULL;
+}
+
+__attribute__((visibility("default")))
+int json_pool_init(struct json_pool* self, int threads)
+{
+    memset(self, 0, sizeof(*self));
+
+    if(threads < 1)
+        threads = 1;
+
+    if(pthread_mutex_init(&self->lock, NULL) != 0)
+        return -1;
+
+    if(pthread_cond_init(&self->work, NULL) != 0)
+        goto work_failure;
+
+    if(pthread_cond_init(&self->done, NULL) != 0)
+        goto done_failure;
+
+    self->threads = malloc((threads - 1) * sizeof(*self->threads) + 1);
+    if(!self->threads)
+        goto threads_failure;
+
+    for(self->thread_count = 0; self->thread_count < threads - 1;
+        ++self->thread_count)
+        if(pthread_create(&self->threads[self->thread_count], NULL, worker,
+                          self) != 0)
+            break;
+
+    if(self->thread_count == threads - 1)
+        return 0;
+
+    json_pool_cleanup(self);
+    return -1;
+
+threads_failure:
+    pthread_cond_destroy(&self->done);
+done_failure:
+    pthread_cond_destroy(&self->work);
+work_failure:
+    pthread_mutex_destroy(&self->lock);
+    return -1;
+}
+
+__attribute__((visibility("default")))
+void json_pool_cleanup(struct json_pool* self)
+{
+    pthread_mutex_lock(&self->lock);
+    self->is_stopping = 1;
+    pthread_cond_broadcast(&self->work);
+    pthread_mutex_unlock(&self->lock);
+
+    int i;
+    for(i = 0; i < self->thread_count; ++i)
+        pthread_join(self->threads[i], NULL);
+
+    free(self->threads);
+    pthread_cond_destroy(&self->done);
+    pthread_cond_destroy(&self->work);
+    pthread_mutex_destroy(&self->lock);
+}
+
+/* Enough chunks for the threads to even out differences in record size, but
+ * not so small that the bookkeeping shows.
+ */
+static size_t chunk_count(const struct json_pool* self, size_t n)
+{
+    size_t count = (self->thread_count + 1) * 4;
+
+    if(count > JSON_POOL_MAX_CHUNKS)
+        count = JSON_POOL_MAX_CHUNKS;
+
+    if(count > (n + JSON_POOL_MIN_CHUNK - 1) / JSON_POOL_MIN_CHUNK)
+        count = (n + JSON_POOL_MIN_CHUNK - 1) / JSON_POOL_MIN_CHUNK;
+
+    return count;
+}
+
+__attribute__((visibility("default")))
+int json_pool_pack(struct json_pool* self, const void* items, size_t n,
+                   size_t item_size,
+                   int (*pack)(const void* item, struct json_buffer* out),
+                   struct json_batch* batch)
+{
+    memset(batch, 0, sizeof(*batch));
+
+    size_t count = chunk_count(self, n);
+    if(count == 0)
+        return 0;
+
+    batch->buffers = calloc(count, sizeof(*batch->buffers));
+    batch->iov = calloc(count, sizeof(*batch->iov));
+    if(!batch->buffers || !batch->iov)
+        return -1;
+
+    batch->count = count;
+
+    struct json_pool_job job = {
+        .items = items,
+        .n = n,
+        .item_size = item_size,
+        .chunk_length = (n + count - 1) / count,
+        .pack = pack,
+        .batch = batch,
+    };
+
+    pthread_mutex_lock(&self->lock);
+
+    while(self->job)
+        pthread_cond_wait(&self->done, &self->lock);
+
+    self->job = &job;
+    self->next_chunk = 0;
+    self->finished_chunks = 0;
+    pthread_cond_broadcast(&self->work);
+
+    run_chunks(self);
+
+    while(self->finished_chunks < count)
+        pthread_cond_wait(&self->done, &self->lock);
+
+    self->job = NULL;
+    pthread_cond_broadcast(&self->done);
+    pthread_mutex_unlock(&self->lock);
+
+    if(job.is_failed)
+        return -1;
+
+    size_t i;
+    for(i = 0; i < count; ++i)
+    {
+        batch->iov[i].iov_base = batch->buffers[i].data;
+        batch->iov[i].iov_len = batch->buffers[i].length;
+        batch->length += batch->buffers[i].length;
+    }
+
+    return 0;
+}
+
+__attribute__((visibility("default")))
+void json_batch_cleanup(struct json_batch* self)
+{
+    int i;
+    if(self->buffers)
+        for(i = 0; i < self->count; ++i)
+            json_buffer_cleanup(&self->buffers[i]);
+
+    free(self->buffers);
+    free(self->iov);
+}
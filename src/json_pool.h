@@ -0,0 +1,76 @@
+/*
+ * Copyright (c) 2015, Marel hf
+ * Copyright (c) 2015, Andri Yngvason
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+ * REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+ * INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+ * OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ */
+#ifndef JSON_POOL_H_INCLUDED_
+#define JSON_POOL_H_INCLUDED_
+
+#include <stdlib.h>
+#include <pthread.h>
+#include <sys/uio.h>
+
+#include "json_buffer.h"
+
+/* Records per chunk below which a batch is not split any further */
+#define JSON_POOL_MIN_CHUNK 64
+
+/* Upper bound on the number of chunks in a batch, which keeps the output
+ * within a single writev().
+ */
+#define JSON_POOL_MAX_CHUNKS 256
+
+struct json_pool_job;
+
+/* Worker threads for packing large batches. The thread that submits a batch
+ * packs chunks as well, so a pool of one thread has no workers at all. A pool
+ * runs one batch at a time; other threads submitting batches wait their turn.
+ */
+struct json_pool {
+    pthread_mutex_t lock;
+    pthread_cond_t work;
+    pthread_cond_t done;
+
+    pthread_t* threads;
+    int thread_count;
+    int is_stopping;
+
+    struct json_pool_job* job;
+    size_t next_chunk;
+    size_t finished_chunks;
+};
+
+/* The packed text of a batch, in order, one buffer per chunk */
+struct json_batch {
+    struct json_buffer* buffers;
+    struct iovec* iov;
+    int count;
+    size_t length;
+};
+
+int json_pool_init(struct json_pool* self, int threads);
+void json_pool_cleanup(struct json_pool* self);
+
+/* Packs 'n' records of 'item_size' bytes each with 'pack', which appends one
+ * record to a buffer and returns 0 on success or -1 on failure. The batch must
+ * be cleaned up even if packing fails.
+ */
+int json_pool_pack(struct json_pool* self, const void* items, size_t n,
+                   size_t item_size,
+                   int (*pack)(const void* item, struct json_buffer* out),
+                   struct json_batch* batch);
+
+void json_batch_cleanup(struct json_batch* self);
+
+#endif /* JSON_POOL_H_INCLUDED_ */
@@ -19,121 +19,219 @@
 #include <stdlib.h>
 #include <string.h>
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 #include "json_string.h"
 
-struct buffer {
-    char* buffer;
-    size_t size;
-    int index;
+/* Output into caller memory. Whatever does not fit is only counted, so
+ * 'length' ends up as the full length of the result.
+ */
+struct output {
+    char* dst;
+    size_t room;
+    size_t length;
 };
 
-static ssize_t buffer_grow(struct buffer* self, size_t size)
+static inline void output_append(struct output* self, const char* str,
+                                 size_t len)
 {
-    if(size < self->size)
-        return 0;
-    else
-        self->size = size*2;
+    if(self->length < self->room)
+    {
+        size_t n = self->room - self->length < len ? self->room - self->length
+                                                   : len;
+        memcpy(&self->dst[self->length], str, n);
+    }
 
-    self->buffer = realloc(self->buffer, self->size);
-    if(!self->buffer)
-        return -1;
+    self->length += len;
+}
 
-    return self->size;
+static inline void output_append_char(struct output* self, char c)
+{
+    output_append(self, &c, 1);
 }
 
-static ssize_t buffer_append(struct buffer* self, char c)
+/* Terminates the output if 'cap' allows, like snprintf() */
+static void output_finish(struct output* self, size_t cap)
 {
-    if(buffer_grow(self, self->index+1) < 0)
-        return -1;
-    
-    self->buffer[self->index++] = c;
+    if(cap > 0)
+        self->dst[self->length < cap ? self->length : cap - 1] = '\0';
+}
 
-    return 1;
+static void output_init(struct output* self, char* dst, size_t cap)
+{
+    self->dst = dst;
+    self->room = cap > 0 ? cap - 1 : 0;
+    self->length = 0;
 }
 
-static ssize_t buffer_append_str(struct buffer* self, const char* str, size_t len)
+static inline int convertdigit(char digit)
 {
-    if(buffer_grow(self, self->index+len) < 0)
+    return isdigit(digit) ? digit - '0' : tolower(digit) - 'a' + 10;
+}
+
+static int parse_hex4(const char* input, const char* end, unsigned int* code)
+{
+    if(end - input < 4)
         return -1;
-    
-    memcpy(&self->buffer[self->index], str, len);
-    self->index += len;
 
-    return (ssize_t)len;
+    int i;
+    for(i = 0; i < 4; ++i)
+        if(!isxdigit((unsigned char)input[i]))
+            return -1;
+
+    *code = convertdigit(input[0]) << 12
+          | convertdigit(input[1]) << 8
+          | convertdigit(input[2]) << 4
+          | convertdigit(input[3]);
+
+    return 0;
 }
 
-static inline int convertdigit(char digit)
+static size_t encode_utf8(char* dst, unsigned int code)
 {
-    return isdigit(digit) ? digit - '0' : tolower(digit) - 'a';
+    if(code < 0x80)
+    {
+        dst[0] = code;
+        return 1;
+    }
+
+    if(code < 0x800)
+    {
+        dst[0] = 0xc0 | code >> 6;
+        dst[1] = 0x80 | (code & 0x3f);
+        return 2;
+    }
+
+    if(code < 0x10000)
+    {
+        dst[0] = 0xe0 | code >> 12;
+        dst[1] = 0x80 | (code >> 6 & 0x3f);
+        dst[2] = 0x80 | (code & 0x3f);
+        return 3;
+    }
+
+    dst[0] = 0xf0 | code >> 18;
+    dst[1] = 0x80 | (code >> 12 & 0x3f);
+    dst[2] = 0x80 | (code >> 6 & 0x3f);
+    dst[3] = 0x80 | (code & 0x3f);
+    return 4;
 }
 
-static ssize_t decode_unicode(struct buffer* output, const char* input,
-                              const char* end)
+__attribute__((visibility("default")))
+ssize_t json_string_decode_unicode(char* dst, const char* input, size_t len,
+                                   size_t* consumed)
 {
-    if(input >= end)
-        return 1;
+    const char* end = input + len;
+    unsigned int code;
 
-    if(!(isxdigit(input[0]) && isxdigit(input[1]) &&
-         isxdigit(input[2]) && isxdigit(input[3])))
-        return 1;
+    if(parse_hex4(input, end, &code) < 0)
+        return -1;
 
-    unsigned int code = convertdigit(input[0]) << 12
-                      | convertdigit(input[1]) << 8
-                      | convertdigit(input[2]) << 4
-                      | convertdigit(input[3]);
+    *consumed = 4;
 
-    /* only ascii is supported for now */
-    if(code <= 0xff)
-        if(buffer_append(output, code) < 0)
-            return -1;
+    if(code >= 0xd800 && code <= 0xdbff)
+    {
+        unsigned int low;
+        if(end - input >= 10 && input[4] == '\\' && input[5] == 'u'
+           && parse_hex4(&input[6], end, &low) == 0
+           && low >= 0xdc00 && low <= 0xdfff)
+        {
+            code = 0x10000 + ((code - 0xd800) << 10) + (low - 0xdc00);
+            *consumed = 10;
+        }
+        else
+        {
+            code = 0xfffd;
+        }
+    }
+    else if(code >= 0xdc00 && code <= 0xdfff)
+    {
+        code = 0xfffd;
+    }
 
-    return 5;
+    return encode_utf8(dst, code);
 }
 
-static ssize_t decode_escape(struct buffer* output, const char* input,
+/* Returns the number of characters consumed after the backslash, or -1 if the
+ * escape is invalid.
+ */
+static ssize_t decode_escape(struct output* output, const char* input,
                              const char* end)
 {
+    char utf8[4];
+    size_t consumed;
+    ssize_t length;
+
     if(input >= end)
         return 1;
 
     switch(*input)
     {
-    case 'b': return buffer_append(output, '\b');
-    case 'f': return buffer_append(output, '\f');
-    case 'n': return buffer_append(output, '\n');
-    case 'r': return buffer_append(output, '\r');
-    case 't': return buffer_append(output, '\t');
-    case 'u': return decode_unicode(output, input+1, end);
-    default:  return buffer_append(output, *input);
+    case 'b': output_append_char(output, '\b'); return 1;
+    case 'f': output_append_char(output, '\f'); return 1;
+    case 'n': output_append_char(output, '\n'); return 1;
+    case 'r': output_append_char(output, '\r'); return 1;
+    case 't': output_append_char(output, '\t'); return 1;
+    case 'u':
+        length = json_string_decode_unicode(utf8, input+1, end - input - 1,
+                                            &consumed);
+        if(length < 0)
+            return -1;
+
+        output_append(output, utf8, length);
+        return consumed + 1;
+    default:  output_append_char(output, *input); return 1;
     }
 }
 
 __attribute__((visibility("default")))
-char* json_string_decode(const char* input, size_t len)
+ssize_t json_string_decode_into(char* dst, size_t cap, const char* input,
+                                size_t len)
 {
     const char* end = input + len;
-    ssize_t sz;
-    struct buffer output;
-    memset(&output, 0, sizeof(output));
-
-    if(buffer_grow(&output, strlen(input)+1) < 0)
-        return NULL;
+    struct output output;
+    output_init(&output, dst, cap);
 
     while(input < end)
     {
-        sz = *input != '\\' ? buffer_append(&output, *input)
-                            : decode_escape(&output, ++input, end);
-
-        if(sz < 0)
-            return NULL;
+        /* memchr() is vectorized, and most strings have no escapes */
+        const char* backslash = memchr(input, '\\', end - input);
+        if(!backslash)
+        {
+            output_append(&output, input, end - input);
+            break;
+        }
+
+        output_append(&output, input, backslash - input);
+
+        ssize_t consumed = decode_escape(&output, backslash + 1, end);
+        if(consumed < 0)
+            return -1;
 
-        input += sz;
+        input = backslash + 1 + consumed;
     }
 
-    if(buffer_append(&output, 0) < 0)
+    output_finish(&output, cap);
+    return output.length;
+}
+
+__attribute__((visibility("default")))
+char* json_string_decode(const char* input, size_t len)
+{
+    /* Escapes only ever make the text shorter */
+    char* output = malloc(len + 1);
+    if(!output)
+        return NULL;
+
+    if(json_string_decode_into(output, len + 1, input, len) < 0)
+    {
+        free(output);
         return NULL;
+    }
 
-    return output.buffer;
+    return output;
 }
 
 static inline char get_hexdigit(int number)
@@ -142,53 +240,186 @@ static inline char get_hexdigit(int number)
     return lookup[number];
 }
 
-static int encode_nonprint(struct buffer* output, char c)
+/* Bytes from 0x80 up are parts of UTF-8 sequences and are kept as they are */
+static inline int needs_escape(unsigned char c)
+{
+    return c < 0x20 || c == '"' || c == '\\' || c == 0x7f;
+}
+
+__attribute__((visibility("default")))
+size_t json_string_find_escape(const char* input, size_t len)
+{
+    size_t i = 0;
+
+#ifdef __SSE2__
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i del = _mm_set1_epi8(0x7f);
+    const __m128i last_control = _mm_set1_epi8(0x1f);
+
+    for(; i + 16 <= len; i += 16)
+    {
+        __m128i chunk = _mm_loadu_si128((const __m128i*)&input[i]);
+
+        /* c <= 0x1f exactly when min(c, 0x1f) == c, unsigned */
+        __m128i control = _mm_cmpeq_epi8(_mm_min_epu8(chunk, last_control),
+                                         chunk);
+        __m128i special = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(chunk, quote),
+                         _mm_cmpeq_epi8(chunk, backslash)),
+            _mm_or_si128(_mm_cmpeq_epi8(chunk, del), control));
+
+        int mask = _mm_movemask_epi8(special);
+        if(mask)
+            return i + __builtin_ctz(mask);
+    }
+#endif
+
+    for(; i < len; ++i)
+        if(needs_escape(input[i]))
+            break;
+
+    return i;
+}
+
+__attribute__((visibility("default")))
+size_t json_string_escape(char* dst, char c)
 {
-    char str[6] = {
-        '\\', 'u', '0', '0',
-        get_hexdigit((c & 0xf0) >> 8),
-        get_hexdigit(c & 0xf)
-    };
+    dst[0] = '\\';
 
-    if(buffer_append_str(output, str, sizeof(str)) < 0)
+    switch(c)
+    {
+    case '\b': dst[1] = 'b'; return 2;
+    case '\f': dst[1] = 'f'; return 2;
+    case '\n': dst[1] = 'n'; return 2;
+    case '\r': dst[1] = 'r'; return 2;
+    case '\t': dst[1] = 't'; return 2;
+    case '\\': dst[1] = '\\'; return 2;
+    case '"':  dst[1] = '"'; return 2;
+    default:   break;
+    }
+
+    dst[1] = 'u';
+    dst[2] = '0';
+    dst[3] = '0';
+    dst[4] = get_hexdigit((c & 0xf0) >> 4);
+    dst[5] = get_hexdigit(c & 0xf);
+    return 6;
+}
+
+__attribute__((visibility("default")))
+size_t json_string_utf8_length(const char* input, size_t len)
+{
+    const unsigned char* s = (const unsigned char*)input;
+
+    if(len == 0)
+        return 0;
+
+    if(s[0] < 0x80)
         return 1;
 
-    return 1;
+    /* The second byte is restricted further to rule out overlong forms,
+     * surrogates and code points above U+10FFFF.
+     */
+    size_t length;
+    unsigned char low = 0x80, high = 0xbf;
+
+    if(s[0] >= 0xc2 && s[0] <= 0xdf)
+        length = 2;
+    else if(s[0] >= 0xe0 && s[0] <= 0xef)
+        length = 3;
+    else if(s[0] >= 0xf0 && s[0] <= 0xf4)
+        length = 4;
+    else
+        return 0;
+
+    if(s[0] == 0xe0)
+        low = 0xa0;
+    else if(s[0] == 0xed)
+        high = 0x9f;
+    else if(s[0] == 0xf0)
+        low = 0x90;
+    else if(s[0] == 0xf4)
+        high = 0x8f;
+
+    if(len < length || s[1] < low || s[1] > high)
+        return 0;
+
+    size_t i;
+    for(i = 2; i < length; ++i)
+        if((s[i] & 0xc0) != 0x80)
+            return 0;
+
+    return length;
 }
 
-static int encode_character(struct buffer* output, char c)
+static inline size_t escape_length(char c)
 {
     switch(c)
     {
-    case '\b': return buffer_append_str(output, "\\b", 2);
-    case '\f': return buffer_append_str(output, "\\f", 2);
-    case '\n': return buffer_append_str(output, "\\n", 2);
-    case '\r': return buffer_append_str(output, "\\r", 2);
-    case '\t': return buffer_append_str(output, "\\t", 2);
-    case '\\': return buffer_append_str(output, "\\\\", 2);
-    case '"':  return buffer_append_str(output, "\\\"", 2);
-    default:   return isprint(c) ? buffer_append(output, c)
-                                 : encode_nonprint(output, c);
+    case '\b': case '\f': case '\n': case '\r': case '\t': case '\\': case '"':
+        return 2;
+    default:
+        return 6;
     }
 }
 
 __attribute__((visibility("default")))
-char* json_string_encode(const char* input, size_t len)
+size_t json_string_encoded_length(const char* input, size_t len)
 {
-    const char* end = input + len;
-    struct buffer output;
-    memset(&output, 0, sizeof(output));
+    size_t length = 0;
 
-    if(buffer_grow(&output, strlen(input)+1) < 0)
-        return NULL;
+    while(len > 0)
+    {
+        size_t run = json_string_find_escape(input, len);
+        length += run;
 
-    while(input < end)
-        if(encode_character(&output, *input++) < 0)
-            return NULL;
+        if(run == len)
+            break;
 
-    if(buffer_append(&output, 0) < 0)
-        return NULL;
+        length += escape_length(input[run]);
+        input += run + 1;
+        len -= run + 1;
+    }
 
-    return output.buffer;
+    return length;
 }
 
+__attribute__((visibility("default")))
+ssize_t json_string_encode_into(char* dst, size_t cap, const char* input,
+                                size_t len)
+{
+    struct output output;
+    output_init(&output, dst, cap);
+
+    while(len > 0)
+    {
+        size_t run = json_string_find_escape(input, len);
+        output_append(&output, input, run);
+
+        if(run == len)
+            break;
+
+        char escape[6];
+        output_append(&output, escape, json_string_escape(escape, input[run]));
+
+        input += run + 1;
+        len -= run + 1;
+    }
+
+    output_finish(&output, cap);
+    return output.length;
+}
+
+__attribute__((visibility("default")))
+char* json_string_encode(const char* input, size_t len)
+{
+    size_t length = json_string_encoded_length(input, len);
+
+    char* output = malloc(length + 1);
+    if(!output)
+        return NULL;
+
+    json_string_encode_into(output, length + 1, input, len);
+    return output;
+}
@@ -18,8 +18,46 @@
 #ifndef JSON_STRING_H_INCLUDED
 #define JSON_STRING_H_INCLUDED
 
+#include <stdlib.h>
+#include <sys/types.h>
+
+/* Return a newly allocated, null terminated result which the caller frees */
 char* json_string_decode(const char* input, size_t len);
 char* json_string_encode(const char* input, size_t len);
 
+/* Write into 'dst' instead and return the length of the result like
+ * snprintf(). The result is complete if the return value is less than 'cap';
+ * 'len' bytes plus one are always enough for decoding.
+ */
+ssize_t json_string_decode_into(char* dst, size_t cap, const char* input,
+                                size_t len);
+ssize_t json_string_encode_into(char* dst, size_t cap, const char* input,
+                                size_t len);
+
+/* The exact length of the encoded string, without a terminating null byte */
+size_t json_string_encoded_length(const char* input, size_t len);
+
+/* Decodes the four hex digits of a \u escape at 'input', along with a second
+ * escape that completes a surrogate pair, and writes the character to 'dst' as
+ * UTF-8, at most 4 bytes. Unpaired surrogates become U+FFFD. Returns the
+ * number of bytes written and sets 'consumed' to the number of characters
+ * read, or returns -1 if the digits are invalid.
+ */
+ssize_t json_string_decode_unicode(char* dst, const char* input, size_t len,
+                                   size_t* consumed);
+
+/* Returns the length of the valid UTF-8 character at 'input', or 0 if the
+ * bytes there are not valid UTF-8.
+ */
+size_t json_string_utf8_length(const char* input, size_t len);
+
+/* Returns the index of the first character that must be escaped, or 'len' if
+ * there is none. These are quotes, backslashes and control characters.
+ */
+size_t json_string_find_escape(const char* input, size_t len);
+
+/* Writes the escape sequence of 'c', at most 6 bytes, and returns its length */
+size_t json_string_escape(char* dst, char c);
+
 #endif /* JSON_STRING_H_INCLUDED */
 
@@ -0,0 +1,318 @@
+/*
+ * Copyright (c) 2015, Marel hf
+ * Copyright (c) 2015, Andri Yngvason
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+ * REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+ * INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+ * OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "jslex.h"
+#include "json_tape.h"
+
+enum tape_state {
+    TAPE_FIRST, /* after '[' or '{' */
+    TAPE_KEY,
+    TAPE_VALUE,
+    TAPE_AFTER_VALUE
+};
+
+static int tape_grow(struct json_tape* self)
+{
+    if(self->length < self->reserved_size)
+        return 0;
+
+    if(self->reserved_size >= JSON_TAPE_NONE / 2)
+        return -1;
+
+    uint32_t size = self->reserved_size ? self->reserved_size * 2 : 16;
+    struct json_tape_node* nodes = realloc(self->nodes, sizeof(*nodes) * size);
+    if(!nodes)
+        return -1;
+
+    self->nodes = nodes;
+    self->reserved_size = size;
+    return 0;
+}
+
+static int buffer_append(char** buffer, size_t* length, size_t* reserved_size,
+                         const char* data, size_t size)
+{
+    if(*length + size > *reserved_size)
+    {
+        size_t new_size = (*length + size) * 2;
+        char* new_buffer = realloc(*buffer, new_size);
+        if(!new_buffer)
+            return -1;
+
+        *buffer = new_buffer;
+        *reserved_size = new_size;
+    }
+
+    memcpy(&(*buffer)[*length], data, size);
+    *length += size;
+    return 0;
+}
+
+static int append_string(struct json_tape* self, const char* str,
+                         uint32_t* offset, uint32_t* length)
+{
+    size_t size = strlen(str);
+
+    if(self->strings_length + size + 1 >= JSON_TAPE_NONE)
+        return -1;
+
+    *offset = self->strings_length;
+    if(length)
+        *length = size;
+
+    return buffer_append(&self->strings, &self->strings_length,
+                         &self->reserved_strings_size, str, size + 1);
+}
+
+static int is_closing(const struct json_tape* self, uint32_t parent,
+                      enum jslex_token_type type)
+{
+    if(parent == JSON_TAPE_NONE)
+        return 0;
+
+    return self->nodes[parent].type == JSON_OBJ_OBJECT ? type == JSLEX_RBRACE
+                                                       : type == JSLEX_RBRACKET;
+}
+
+static int set_scalar(struct json_tape* self, struct json_tape_node* node,
+                      const struct jslex_token* tok)
+{
+    switch(tok->type)
+    {
+    case JSLEX_INTEGER:
+        node->type = JSON_OBJ_INTEGER;
+        node->value.integer = tok->value.integer;
+        return 0;
+    case JSLEX_REAL:
+        node->type = JSON_OBJ_REAL;
+        node->value.real = tok->value.real;
+        return 0;
+    case JSLEX_STRING:
+        node->type = JSON_OBJ_STRING;
+        return append_string(self, tok->value.str, &node->value.string,
+                             &node->length);
+    case JSLEX_LITERAL:
+        if(0 == strcmp(tok->value.str, "null"))
+        {
+            node->type = JSON_OBJ_NULL;
+            return 0;
+        }
+
+        node->type = JSON_OBJ_BOOL;
+        node->value.boolean = 0 == strcmp(tok->value.str, "true");
+        return node->value.boolean || 0 == strcmp(tok->value.str, "false")
+             ? 0 : -1;
+    default:
+        break;
+    }
+
+    return -1;
+}
+
+/* Parses one value from the lexer onto the tape, replacing what was there.
+ * Open containers are linked through their 'next' field until they are
+ * closed, so nesting depth is not limited by the call stack.
+ */
+__attribute__((visibility("default")))
+int json_tape_parse(struct json_tape* self, struct jslex* lexer)
+{
+    enum tape_state state = TAPE_VALUE;
+    uint32_t parent = JSON_TAPE_NONE;
+    uint32_t key = JSON_TAPE_NONE;
+    const char* start = NULL;
+    struct jslex_token* tok;
+
+    json_tape_reset(self);
+
+    while(state != TAPE_AFTER_VALUE || parent != JSON_TAPE_NONE)
+    {
+        tok = jslex_next_token(lexer);
+        if(!tok)
+            return -1;
+
+        if(!start)
+            start = lexer->pos;
+
+        switch(state)
+        {
+        case TAPE_FIRST:
+            if(is_closing(self, parent, tok->type))
+                break;
+
+            state = self->nodes[parent].type == JSON_OBJ_OBJECT ? TAPE_KEY
+                                                                : TAPE_VALUE;
+            continue;
+        case TAPE_KEY:
+            if(tok->type != JSLEX_STRING)
+                return -1;
+
+            if(append_string(self, tok->value.str, &key, NULL) < 0)
+                return -1;
+
+            jslex_accept_token(lexer);
+
+            tok = jslex_next_token(lexer);
+            if(!tok || tok->type != JSLEX_COLON)
+                return -1;
+
+            jslex_accept_token(lexer);
+            state = TAPE_VALUE;
+            continue;
+        case TAPE_VALUE:
+            if(tape_grow(self) < 0)
+                return -1;
+
+            uint32_t index = self->length++;
+            struct json_tape_node* node = &self->nodes[index];
+            memset(node, 0, sizeof(*node));
+            node->key = key;
+            key = JSON_TAPE_NONE;
+
+            if(parent != JSON_TAPE_NONE)
+                self->nodes[parent].length++;
+
+            jslex_accept_token(lexer);
+
+            if(tok->type == JSLEX_LBRACE || tok->type == JSLEX_LBRACKET)
+            {
+                node->type = tok->type == JSLEX_LBRACE ? JSON_OBJ_OBJECT
+                                                       : JSON_OBJ_ARRAY;
+                node->next = parent;
+                parent = index;
+                state = TAPE_FIRST;
+                continue;
+            }
+
+            if(set_scalar(self, node, tok) < 0)
+                return -1;
+
+            node->next = self->length;
+            state = TAPE_AFTER_VALUE;
+            continue;
+        case TAPE_AFTER_VALUE:
+            if(tok->type == JSLEX_COMMA)
+            {
+                jslex_accept_token(lexer);
+                state = self->nodes[parent].type == JSON_OBJ_OBJECT ? TAPE_KEY
+                                                                    : TAPE_VALUE;
+                continue;
+            }
+
+            if(!is_closing(self, parent, tok->type))
+                return -1;
+
+            break;
+        }
+
+        /* Close the innermost container */
+        jslex_accept_token(lexer);
+        uint32_t outer = self->nodes[parent].next;
+        self->nodes[parent].next = self->length;
+        parent = outer;
+        state = TAPE_AFTER_VALUE;
+    }
+
+    return buffer_append(&self->text, &self->text_length,
+                         &self->reserved_text_size, start,
+                         lexer->next_pos - start);
+}
+
+__attribute__((visibility("default")))
+void json_tape_reset(struct json_tape* self)
+{
+    self->length = 0;
+    self->strings_length = 0;
+    self->text_length = 0;
+}
+
+__attribute__((visibility("default")))
+void json_tape_cleanup(struct json_tape* self)
+{
+    free(self->nodes);
+    free(self->strings);
+    free(self->text);
+    memset(self, 0, sizeof(*self));
+}
+
+__attribute__((visibility("default")))
+const struct json_tape_node* json_tape_root(const struct json_tape* self)
+{
+    return self->length > 0 ? &self->nodes[0] : NULL;
+}
+
+/* Returns the node after 'node' and its children; this is only a sibling if
+ * 'node' is not the last child of its parent.
+ */
+__attribute__((visibility("default")))
+const struct json_tape_node* json_tape_next(const struct json_tape* self,
+                                            const struct json_tape_node* node)
+{
+    return node->next < self->length ? &self->nodes[node->next] : NULL;
+}
+
+__attribute__((visibility("default")))
+const struct json_tape_node* json_tape_child(const struct json_tape* self,
+                                             const struct json_tape_node* node,
+                                             uint32_t index)
+{
+    if(index >= node->length || (node->type != JSON_OBJ_OBJECT
+                                 && node->type != JSON_OBJ_ARRAY))
+        return NULL;
+
+    const struct json_tape_node* child = node + 1;
+
+    while(index--)
+        child = &self->nodes[child->next];
+
+    return child;
+}
+
+__attribute__((visibility("default")))
+const struct json_tape_node* json_tape_member(const struct json_tape* self,
+                                              const struct json_tape_node* node,
+                                              const char* key)
+{
+    if(node->type != JSON_OBJ_OBJECT)
+        return NULL;
+
+    const struct json_tape_node* child = node + 1;
+
+    uint32_t i;
+    for(i = 0; i < node->length; ++i, child = &self->nodes[child->next])
+        if(0 == strcmp(key, &self->strings[child->key]))
+            return child;
+
+    return NULL;
+}
+
+__attribute__((visibility("default")))
+const char* json_tape_key(const struct json_tape* self,
+                          const struct json_tape_node* node)
+{
+    return node->key != JSON_TAPE_NONE ? &self->strings[node->key] : NULL;
+}
+
+__attribute__((visibility("default")))
+const char* json_tape_string(const struct json_tape* self,
+                             const struct json_tape_node* node)
+{
+    return node->type == JSON_OBJ_STRING ? &self->strings[node->value.string]
+                                         : NULL;
+}
@@ -0,0 +1,89 @@
+/*
+ * Copyright (c) 2015, Marel hf
+ * Copyright (c) 2015, Andri Yngvason
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+ * REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+ * INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+ * OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef JSON_TAPE_H_INCLUDED_
+#define JSON_TAPE_H_INCLUDED_
+
+#include <stdint.h>
+#include <stdlib.h>
+
+struct jslex;
+
+enum json_obj_type {
+    JSON_OBJ_NULL = 0,
+    JSON_OBJ_OBJECT,
+    JSON_OBJ_ARRAY,
+    JSON_OBJ_REAL,
+    JSON_OBJ_INTEGER,
+    JSON_OBJ_STRING,
+    JSON_OBJ_BOOL
+};
+
+#define JSON_TAPE_NONE UINT32_MAX
+
+/* A JSON value is stored on the tape in document order, each node followed by
+ * the nodes of its children. 'next' is the index of the node that follows the
+ * whole subtree, i.e. the next sibling, if any. Keys and strings are offsets
+ * into the string arena of the tape.
+ */
+struct json_tape_node {
+    enum json_obj_type type;
+    uint32_t key;
+    uint32_t length; /* children of objects and arrays, bytes of strings */
+    uint32_t next;
+    union {
+        long long integer;
+        double real;
+        int boolean;
+        uint32_t string;
+    } value;
+};
+
+struct json_tape {
+    struct json_tape_node* nodes;
+    uint32_t length;
+    uint32_t reserved_size;
+
+    char* strings;
+    size_t strings_length;
+    size_t reserved_strings_size;
+
+    /* The value as it appeared in the input */
+    char* text;
+    size_t text_length;
+    size_t reserved_text_size;
+};
+
+int json_tape_parse(struct json_tape* self, struct jslex* lexer);
+void json_tape_reset(struct json_tape* self);
+void json_tape_cleanup(struct json_tape* self);
+
+const struct json_tape_node* json_tape_root(const struct json_tape* self);
+const struct json_tape_node* json_tape_next(const struct json_tape* self,
+                                            const struct json_tape_node* node);
+const struct json_tape_node* json_tape_child(const struct json_tape* self,
+                                             const struct json_tape_node* node,
+                                             uint32_t index);
+const struct json_tape_node* json_tape_member(const struct json_tape* self,
+                                              const struct json_tape_node* node,
+                                              const char* key);
+const char* json_tape_key(const struct json_tape* self,
+                          const struct json_tape_node* node);
+const char* json_tape_string(const struct json_tape* self,
+                             const struct json_tape_node* node);
+
+#endif /* JSON_TAPE_H_INCLUDED_ */
@@ -15,21 +15,224 @@
  * PERFORMANCE OF THIS SOFTWARE.
  */
 
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+
 #include <lua.h>
 #include <lualib.h>
 #include <lauxlib.h>
 
 #include "obj.h"
 #include "lua_obj.h"
+#include "lua_codegen.h"
+#include "templates.h"
+
+#define C_SOURCE "c_source.lua"
+#define C_HEADER "c_header.lua"
+
+static const char* template_names[] = {
+    [LUA_CODEGEN_SOURCE] = C_SOURCE,
+    [LUA_CODEGEN_HEADER] = C_HEADER,
+};
+
+/* Replaces print() so that the output of the templates can be collected */
+static int codegen_print(lua_State* L)
+{
+    int count = lua_gettop(L);
+
+    lua_getfield(L, LUA_REGISTRYINDEX, "jsoncc_output");
+    struct json_buffer* output = lua_touserdata(L, -1);
+    lua_pop(L, 1);
+
+    int i;
+    for(i = 1; i <= count; ++i)
+    {
+        size_t length;
+        const char* str = lua_tolstring(L, i, &length);
+        if(!str)
+            return luaL_error(L, "print: argument %d is not a string", i);
+
+        if((i > 1 && json_buffer_append(output, "\t", 1) < 0)
+           || json_buffer_append(output, str, length) < 0)
+            return luaL_error(L, "print: out of memory");
+    }
+
+    if(json_buffer_append(output, "\n", 1) < 0)
+        return luaL_error(L, "print: out of memory");
+
+    return 0;
+}
+
+uint64_t lua_codegen_hash(uint64_t hash, const void* data, size_t length)
+{
+    const unsigned char* bytes = data;
+    size_t i;
+
+    for(i = 0; i < length; ++i)
+    {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
 
-int lua_codegen(const char* template, const char* name, const struct obj* obj)
+    return hash;
+}
+
+static char* read_file(const char* path, size_t* length)
+{
+    FILE* file = fopen(path, "rb");
+    if(!file)
+        return NULL;
+
+    struct json_buffer buffer;
+    if(json_buffer_init(&buffer, 65536) < 0)
+        goto buffer_failure;
+
+    char chunk[4096];
+    size_t size;
+    while((size = fread(chunk, 1, sizeof(chunk), file)) > 0)
+        if(json_buffer_append(&buffer, chunk, size) < 0)
+            goto failure;
+
+    if(ferror(file))
+        goto failure;
+
+    fclose(file);
+    *length = buffer.length;
+    return json_buffer_release(&buffer);
+
+failure:
+    json_buffer_cleanup(&buffer);
+buffer_failure:
+    fclose(file);
+    return NULL;
+}
+
+static const struct embedded_template* find_embedded(const char* name)
 {
-    int r = 0;
-    lua_State* L = luaL_newstate();
-    if(!L)
+    const struct embedded_template* template;
+
+    for(template = embedded_templates; template->name; ++template)
+        if(strcmp(template->name, name) == 0)
+            return template;
+
+    return NULL;
+}
+
+/* The templates are compiled once and kept in the registry. Their bytes are
+ * hashed for telling whether generated code is up to date.
+ *
+ * Without a template path, the templates that were compiled into jsoncc are
+ * loaded. As bytecode, which is the default, this saves reading and
+ * compiling the templates on every run.
+ */
+static int load_template(struct lua_codegen* self, const char* template_path,
+                         enum lua_codegen_template template)
+{
+    const char* text;
+    size_t length;
+    char* file_text = NULL;
+    char name[258];
+
+    if(template_path)
+    {
+        char path[256];
+        snprintf(path, sizeof(path), "%s/%s", template_path,
+                 template_names[template]);
+        path[sizeof(path) - 1] = '\0';
+
+        file_text = read_file(path, &length);
+        if(!file_text)
+        {
+            fprintf(stderr, "Loading template '%s' failed: %s\n", path,
+                    strerror(errno));
+            return -1;
+        }
+
+        text = file_text;
+        snprintf(name, sizeof(name), "@%s", path);
+    }
+    else
+    {
+        const struct embedded_template* embedded =
+            find_embedded(template_names[template]);
+        if(!embedded)
+        {
+            fprintf(stderr, "Template '%s' is not built in\n",
+                    template_names[template]);
+            return -1;
+        }
+
+        text = (const char*)embedded->data;
+        length = embedded->size;
+        snprintf(name, sizeof(name), "=%s", embedded->name);
+    }
+
+    self->template_hash[template] = lua_codegen_hash(LUA_CODEGEN_HASH_INIT,
+                                                     text, length);
+
+    int r = luaL_loadbuffer(self->L, text, length, name);
+    free(file_text);
+
+    if(r != 0)
+    {
+        fprintf(stderr, "Loading template failed: %s\n",
+                lua_tostring(self->L, -1));
+        lua_pop(self->L, 1);
+        return -1;
+    }
+
+    lua_setfield(self->L, LUA_REGISTRYINDEX, template_names[template]);
+    return 0;
+}
+
+int lua_codegen_init(struct lua_codegen* self, const char* template_path)
+{
+    memset(self, 0, sizeof(*self));
+
+    if(json_buffer_init(&self->output, 65536) < 0)
         return -1;
 
-    luaL_openlibs(L);
+    self->L = luaL_newstate();
+    if(!self->L)
+        goto failure;
+
+    luaL_openlibs(self->L);
+
+    lua_pushlightuserdata(self->L, &self->output);
+    lua_setfield(self->L, LUA_REGISTRYINDEX, "jsoncc_output");
+
+    lua_pushcfunction(self->L, codegen_print);
+    lua_setglobal(self->L, "print");
+
+    if(load_template(self, template_path, LUA_CODEGEN_SOURCE) < 0
+       || load_template(self, template_path, LUA_CODEGEN_HEADER) < 0)
+        goto failure;
+
+    return 0;
+
+failure:
+    lua_codegen_cleanup(self);
+    return -1;
+}
+
+void lua_codegen_cleanup(struct lua_codegen* self)
+{
+    if(self->L)
+        lua_close(self->L);
+
+    json_buffer_cleanup(&self->output);
+}
+
+const char* lua_codegen(struct lua_codegen* self,
+                        enum lua_codegen_template template, const char* name,
+                        const struct obj* obj, int validate_utf8,
+                        size_t* length)
+{
+    lua_State* L = self->L;
+
+    self->output.length = 0;
+    self->output.data[0] = '\0';
 
     lua_pushstring(L, name);
     lua_setglobal(L, "JSON_NAME");
@@ -37,14 +240,17 @@ int lua_codegen(const char* template, const char* name, const struct obj* obj)
     lua_obj_new(L, obj);
     lua_setglobal(L, "JSON_ROOT");
 
-    if(luaL_dofile(L, template) != 0)
+    lua_pushboolean(L, validate_utf8);
+    lua_setglobal(L, "JSON_VALIDATE_UTF8");
+
+    lua_getfield(L, LUA_REGISTRYINDEX, template_names[template]);
+    if(lua_pcall(L, 0, 0, 0) != 0)
     {
         fprintf(stderr, "Running template failed: %s\n", lua_tostring(L, -1));
-        r = -1;
+        lua_pop(L, 1);
+        return NULL;
     }
 
-    lua_close(L);
-
-    return r;
+    *length = self->output.length;
+    return self->output.data;
 }
-
@@ -18,7 +18,45 @@
 #ifndef LUA_CODEGEN_H_INCLUDED
 #define LUA_CODEGEN_H_INCLUDED
 
-int lua_codegen(const char*, const char* name, const struct obj* obj);
+#include <stdint.h>
+#include <stdlib.h>
 
-#endif /* LUA_CODEGEN_H_INCLUDED */
+#include "json_buffer.h"
+
+#define LUA_CODEGEN_HASH_INIT 14695981039346656037ull
+
+struct lua_State;
+struct obj;
+
+enum lua_codegen_template {
+    LUA_CODEGEN_SOURCE,
+    LUA_CODEGEN_HEADER,
+};
+
+/* A Lua state with the templates loaded, which can generate code for any
+ * number of schemas.
+ */
+struct lua_codegen {
+    struct lua_State* L;
+    struct json_buffer output;
+    uint64_t template_hash[2];
+};
 
+/* Loads the templates from 'template_path', or the built in ones if it is
+ * NULL.
+ */
+int lua_codegen_init(struct lua_codegen* self, const char* template_path);
+void lua_codegen_cleanup(struct lua_codegen* self);
+
+/* Returns the generated code, which stays valid until the next call, or NULL
+ * on failure.
+ */
+const char* lua_codegen(struct lua_codegen* self,
+                        enum lua_codegen_template template, const char* name,
+                        const struct obj* obj, int validate_utf8,
+                        size_t* length);
+
+/* Adds 'data' to a 64 bit FNV-1a hash, starting from LUA_CODEGEN_HASH_INIT */
+uint64_t lua_codegen_hash(uint64_t hash, const void* data, size_t length);
+
+#endif /* LUA_CODEGEN_H_INCLUDED */
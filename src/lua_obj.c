@@ -75,6 +75,28 @@ static int l_obj_ctype(lua_State* L)
     return 1;
 }
 
+static int l_obj_min(lua_State* L)
+{
+    struct obj* self = get_self(L);
+    const char* min = obj_strmin(self);
+    if(!min)
+        return 0;
+
+    lua_pushstring(L, min);
+    return 1;
+}
+
+static int l_obj_max(lua_State* L)
+{
+    struct obj* self = get_self(L);
+    const char* max = obj_strmax(self);
+    if(!max)
+        return 0;
+
+    lua_pushstring(L, max);
+    return 1;
+}
+
 static int l_obj_name(lua_State* L)
 {
     struct obj* self = get_self(L);
@@ -103,6 +125,48 @@ static int l_obj_is_optional(lua_State* L)
     return 1;
 }
 
+static int l_obj_is_stream(lua_State* L)
+{
+    struct obj* self = get_self(L);
+    lua_pushboolean(L, self->is_stream);
+    return 1;
+}
+
+static int l_obj_batch_size(lua_State* L)
+{
+    struct obj* self = get_self(L);
+    lua_pushinteger(L, self->batch_size);
+    return 1;
+}
+
+static int l_obj_dimensions(lua_State* L)
+{
+    struct obj* self = get_self(L);
+    lua_pushinteger(L, self->dimensions);
+    return 1;
+}
+
+static int l_obj_is_columnar(lua_State* L)
+{
+    struct obj* self = get_self(L);
+    lua_pushboolean(L, self->is_columnar);
+    return 1;
+}
+
+static int l_obj_is_interned(lua_State* L)
+{
+    struct obj* self = get_self(L);
+    lua_pushboolean(L, self->is_interned);
+    return 1;
+}
+
+static int l_obj_max_length(lua_State* L)
+{
+    struct obj* self = get_self(L);
+    lua_pushinteger(L, self->max_length);
+    return 1;
+}
+
 static int l_call_index(lua_State* L)
 {
     /* { table, string } */
@@ -117,9 +181,17 @@ static int l_call_index(lua_State* L)
     if(0 == strcmp(index, "type"))        return l_obj_type(L);
     if(0 == strcmp(index, "name"))        return l_obj_name(L);
     if(0 == strcmp(index, "ctype"))       return l_obj_ctype(L);
+    if(0 == strcmp(index, "min"))         return l_obj_min(L);
+    if(0 == strcmp(index, "max"))         return l_obj_max(L);
     if(0 == strcmp(index, "length"))      return l_obj_length(L);
+    if(0 == strcmp(index, "dimensions"))  return l_obj_dimensions(L);
     if(0 == strcmp(index, "children"))    return l_obj_children(L);
     if(0 == strcmp(index, "is_optional")) return l_obj_is_optional(L);
+    if(0 == strcmp(index, "is_stream"))   return l_obj_is_stream(L);
+    if(0 == strcmp(index, "batch_size"))  return l_obj_batch_size(L);
+    if(0 == strcmp(index, "is_columnar")) return l_obj_is_columnar(L);
+    if(0 == strcmp(index, "is_interned")) return l_obj_is_interned(L);
+    if(0 == strcmp(index, "max_length"))  return l_obj_max_length(L);
 
     return 0;
 }
@@ -25,6 +25,8 @@
 #include <unistd.h>
 #include <getopt.h>
 #include <errno.h>
+#include <sys/types.h>
+#include <sys/wait.h>
 
 #include "desc_parser.h"
 #include "obj.h"
@@ -32,24 +34,28 @@
 
 #define READ_CHUNK_SIZE 256
 
-#ifndef TEMPLATE_PATH
-#define TEMPLATE_PATH "./templates"
+#ifndef JSONCC_VERSION
+#define JSONCC_VERSION "unknown"
 #endif
 
-#define C_SOURCE "c_source.lua"
-#define C_HEADER "c_header.lua"
-
 void usage()
 {
     printf("\
 Usage: jsoncc [options] input-file\n\
+       jsoncc [options] --out-dir=DIR input-file...\n\
 \n\
 Options:\n\
     -H, --header                  Generate header.\n\
     -h, --help                    Get help.\n\
+    -j, --jobs=N                  Number of worker processes for --out-dir\n\
+                                  (default is the number of CPUs).\n\
     -n, --name=NAME               Struct name (default is file name).\n\
+    -o, --out-dir=DIR             Write <name>.h and <name>.c for each input\n\
+                                  file to DIR, unless they are up to date.\n\
     -s, --source                  Generate source.\n\
-    -t, --template-path=PATH      Specify path to templates.\n\
+    -t, --template-path=PATH      Load templates from PATH instead of using\n\
+                                  the built in ones.\n\
+    -u, --validate-utf8           Reject strings which are not valid UTF-8.\n\
 ");
 }
 
@@ -117,47 +123,331 @@ char* strip_extension(char* path)
     return path;
 }
 
-int main(int argc, char* argv[])
+struct options {
+    int is_source;
+    int is_header;
+    const char* name;
+    const char* template_path;
+    const char* out_dir;
+    int jobs;
+    int validate_utf8;
+};
+
+/* Generated code starts with a hash of everything that went into it: the
+ * schema, the template, the options and the version of jsoncc.
+ */
+static void make_stamp(char* stamp, size_t size, struct lua_codegen* codegen,
+                       const struct options* options,
+                       enum lua_codegen_template template, const char* name,
+                       const char* input)
+{
+    uint64_t hash = LUA_CODEGEN_HASH_INIT;
+    hash = lua_codegen_hash(hash, JSONCC_VERSION, sizeof(JSONCC_VERSION));
+    hash = lua_codegen_hash(hash, &codegen->template_hash[template],
+                            sizeof(codegen->template_hash[template]));
+    hash = lua_codegen_hash(hash, name, strlen(name) + 1);
+    hash = lua_codegen_hash(hash, &options->validate_utf8,
+                            sizeof(options->validate_utf8));
+    hash = lua_codegen_hash(hash, input, strlen(input));
+
+    snprintf(stamp, size, "/* Generated by jsoncc %s, hash %016llx */\n",
+             JSONCC_VERSION, (unsigned long long)hash);
+}
+
+/* A file is up to date if it starts with the same stamp */
+static int is_up_to_date(const char* path, const char* stamp)
+{
+    char line[256];
+
+    FILE* file = fopen(path, "r");
+    if(!file)
+        return 0;
+
+    int r = fgets(line, sizeof(line), file) && strcmp(line, stamp) == 0;
+
+    fclose(file);
+    return r;
+}
+
+/* The file is written under a temporary name and renamed, so an interrupted
+ * run cannot leave a partial file with a valid stamp behind.
+ */
+static int write_file(const char* path, const char* stamp, const char* data,
+                      size_t length)
+{
+    char tmp_path[4096 + 32];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp%d", path, (int)getpid());
+
+    FILE* file = fopen(tmp_path, "w");
+    if(!file)
+        goto failure;
+
+    if(fputs(stamp, file) < 0 || fwrite(data, 1, length, file) != length)
+    {
+        fclose(file);
+        goto write_failure;
+    }
+
+    if(fclose(file) != 0)
+        goto write_failure;
+
+    if(rename(tmp_path, path) < 0)
+        goto write_failure;
+
+    return 0;
+
+write_failure:
+    unlink(tmp_path);
+failure:
+    fprintf(stderr, "Failed to write '%s': %s\n", path, strerror(errno));
+    return -1;
+}
+
+static int generate(struct lua_codegen* codegen, const struct options* options,
+                    enum lua_codegen_template template, const char* name,
+                    const struct obj* obj, const char* input)
+{
+    char stamp[128];
+    make_stamp(stamp, sizeof(stamp), codegen, options, template, name, input);
+
+    char path[4096];
+    if(options->out_dir)
+    {
+        snprintf(path, sizeof(path), "%s/%s.%s", options->out_dir, name,
+                 template == LUA_CODEGEN_HEADER ? "h" : "c");
+        path[sizeof(path) - 1] = '\0';
+
+        if(is_up_to_date(path, stamp))
+            return 0;
+    }
+
+    size_t length;
+    const char* code = lua_codegen(codegen, template, name, obj,
+                                   options->validate_utf8, &length);
+    if(!code)
+        return -1;
+
+    if(!options->out_dir)
+        return fputs(stamp, stdout) >= 0
+            && fwrite(code, 1, length, stdout) == length ? 0 : -1;
+
+    return write_file(path, stamp, code, length);
+}
+
+static int compile_file(struct lua_codegen* codegen,
+                        const struct options* options, const char* input_path)
+{
+    int r = -1;
+
+    char* input = read_input_file(input_path);
+    if(!input)
+    {
+        fprintf(stderr, "Failed to read input file '%s': %s\n", input_path,
+                strerror(errno));
+        return -1;
+    }
+
+    char* path = strdup(input_path);
+    if(!path)
+        goto path_failure;
+
+    const char* name = options->name ? options->name
+                                     : strip_extension(basename(path));
+
+    struct desc_parser parser;
+    struct obj* obj = desc_parse(&parser, input);
+    if(!obj)
+    {
+        fprintf(stderr, "%s: ", input_path);
+        desc_print_error_report(&parser, stderr);
+        goto parse_failure;
+    }
+
+    if(options->is_header
+       && generate(codegen, options, LUA_CODEGEN_HEADER, name, obj, input) < 0)
+        goto failure;
+
+    if(options->is_source
+       && generate(codegen, options, LUA_CODEGEN_SOURCE, name, obj, input) < 0)
+        goto failure;
+
+    r = 0;
+failure:
+    obj_free(obj);
+parse_failure:
+    free(path);
+path_failure:
+    free(input);
+    return r;
+}
+
+/* Compiles every 'stride'th input file, starting at 'first', in a single Lua
+ * state.
+ */
+static int compile_files(const struct options* options, char* paths[],
+                         int count, int first, int stride)
 {
-    int r = 1;
-    int c;
+    struct lua_codegen codegen;
+    if(lua_codegen_init(&codegen, options->template_path) < 0)
+        return -1;
+
+    int r = 0;
+    int i;
+    for(i = first; i < count; i += stride)
+        if(compile_file(&codegen, options, paths[i]) < 0)
+            r = -1;
+
+    lua_codegen_cleanup(&codegen);
+    return r;
+}
 
-    int is_source = 0;
-    int is_header = 0;
-    const char* name = NULL;
-    const char* template_path = TEMPLATE_PATH;
+struct output_name {
+    char* path; /* copy of the input path, which 'name' points into */
+    const char* name;
+    const char* input_path;
+};
 
-    static const struct option options[] = {
+static int compare_output_names(const void* a, const void* b)
+{
+    return strcmp(((const struct output_name*)a)->name,
+                  ((const struct output_name*)b)->name);
+}
+
+/* Input files which only differ in directory or extension would write the
+ * same files to the output directory, so they are rejected before any worker
+ * is started.
+ */
+static int check_output_names(const struct options* options, char* paths[],
+                              int count)
+{
+    int r = -1;
+    int i;
+
+    struct output_name* names = calloc(count, sizeof(*names));
+    if(!names)
+        goto alloc_failure;
+
+    for(i = 0; i < count; ++i)
+    {
+        names[i].path = strdup(paths[i]);
+        if(!names[i].path)
+            goto alloc_failure;
+
+        names[i].name = strip_extension(basename(names[i].path));
+        names[i].input_path = paths[i];
+    }
+
+    qsort(names, count, sizeof(*names), compare_output_names);
+
+    r = 0;
+    for(i = 1; i < count; ++i)
+        if(strcmp(names[i - 1].name, names[i].name) == 0)
+        {
+            fprintf(stderr, "'%s' and '%s' would both be written to %s/%s.[ch]\n",
+                    names[i - 1].input_path, names[i].input_path,
+                    options->out_dir, names[i].name);
+            r = -1;
+        }
+
+    goto done;
+
+alloc_failure:
+    fprintf(stderr, "Out of memory\n");
+done:
+    if(names)
+        for(i = 0; i < count; ++i)
+            free(names[i].path);
+    free(names);
+    return r;
+}
+
+/* The input files are shared out between worker processes, each of which
+ * loads the templates into a Lua state of its own.
+ */
+static int compile_in_parallel(const struct options* options, char* paths[],
+                               int count)
+{
+    int jobs = options->jobs < count ? options->jobs : count;
+    if(jobs <= 1)
+        return compile_files(options, paths, count, 0, 1);
+
+    fflush(stdout);
+    fflush(stderr);
+
+    int started = 0;
+    int r = 0;
+
+    for(; started < jobs; ++started)
+    {
+        pid_t pid = fork();
+        if(pid < 0)
+        {
+            fprintf(stderr, "Failed to start worker: %s\n", strerror(errno));
+            r = -1;
+            break;
+        }
+
+        if(pid == 0)
+            _exit(compile_files(options, paths, count, started, jobs) < 0);
+    }
+
+    int status;
+    for(; started > 0; --started)
+        if(wait(&status) < 0 || !WIFEXITED(status)
+           || WEXITSTATUS(status) != 0)
+            r = -1;
+
+    return r;
+}
+
+int main(int argc, char* argv[])
+{
+    struct options options;
+    memset(&options, 0, sizeof(options));
+
+    static const struct option long_options[] = {
         { "header",        no_argument,       0, 'H' },
         { "help",          no_argument,       0, 'h' },
+        { "jobs",          required_argument, 0, 'j' },
         { "name",          required_argument, 0, 'n' },
+        { "out-dir",       required_argument, 0, 'o' },
         { "source",        no_argument,       0, 's' },
         { "template-path", required_argument, 0, 't' },
+        { "validate-utf8", no_argument,       0, 'u' },
         { 0, 0, 0, 0 }
     };
 
     while(1)
     {
-        c = getopt_long(argc, argv, "Hhn:st:", options, NULL);
+        int c = getopt_long(argc, argv, "Hhj:n:o:st:u", long_options, NULL);
         if(c == -1)
             break;
 
         switch(c)
         {
         case 'H':
-            is_header = 1;
+            options.is_header = 1;
             break;
         case 's':
-            is_source = 1;
+            options.is_source = 1;
             break;
         case 'h':
             usage();
             return 0;
+        case 'j':
+            options.jobs = atoi(optarg);
+            break;
         case 'n':
-            name = optarg;
+            options.name = optarg;
+            break;
+        case 'o':
+            options.out_dir = optarg;
             break;
         case 't':
-            template_path = optarg;
+            options.template_path = optarg;
+            break;
+        case 'u':
+            options.validate_utf8 = 1;
             break;
         default:
             usage();
@@ -165,60 +455,52 @@ int main(int argc, char* argv[])
         }
     }
 
-    if(is_header && is_source)
-    {
-        fprintf(stderr, "Can't output source and header at the same time.\n");
-        usage();
-        return 1;
-    }
+    int count = argc - optind;
+    char** paths = &argv[optind];
 
-    if(!is_header && !is_source)
+    if(count < 1)
     {
-        fprintf(stderr, "Please specify either source or header output: -s or -H.\n");
-        usage();
+        fprintf(stderr, "Too few arguments!\n");
         return 1;
     }
 
-    if(argc - optind < 1)
+    if(options.out_dir)
     {
-        fprintf(stderr, "Too few arguments!\n");
-        return 1;
-    }
+        /* Both are generated unless one is asked for */
+        if(!options.is_header && !options.is_source)
+            options.is_header = options.is_source = 1;
 
-    const char* input_path = argv[optind];
-    if(strcmp("-", input_path) == 0)
-        input_path = "/dev/stdin";
+        if(options.name && count > 1)
+        {
+            fprintf(stderr, "A name can only be given for a single input file.\n");
+            return 1;
+        }
 
-    char* input = read_input_file(input_path);
-    if(!input)
+        if(check_output_names(&options, paths, count) < 0)
+            return 1;
+
+        if(options.jobs <= 0)
+            options.jobs = sysconf(_SC_NPROCESSORS_ONLN);
+
+        return compile_in_parallel(&options, paths, count) < 0;
+    }
+
+    if(options.is_header && options.is_source)
     {
-        fprintf(stderr, "Failed to read input file '%s': %s\n", input_path,
-                strerror(errno));
+        fprintf(stderr, "Can't output source and header at the same time.\n");
+        usage();
         return 1;
     }
 
-    if(!name)
-        name = strip_extension(basename(input_path));
-
-    struct obj* obj = desc_parse(input);
-    if(!obj)
+    if(!options.is_header && !options.is_source)
     {
-        desc_print_error_report();
-        goto failure;
+        fprintf(stderr, "Please specify either source or header output: -s or -H.\n");
+        usage();
+        return 1;
     }
 
-    char template[256];
-    snprintf(template, sizeof(template), "%s/%s", template_path,
-             is_header ? C_HEADER : C_SOURCE);
-    template[sizeof(template) - 1] = '\0';
-
-    lua_codegen(template, name, obj);
+    if(strcmp("-", paths[0]) == 0)
+        paths[0] = "/dev/stdin";
 
-    obj_free(obj);
-
-    r = 0;
-failure:
-    free(input);
-    return r;
+    return compile_files(&options, paths, 1, 0, 1) < 0;
 }
-
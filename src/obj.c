@@ -30,13 +30,15 @@ struct obj* obj_new()
     memset(self, 0, sizeof(*self));
 
     self->length = 1;
+    self->dimensions = 1;
+    self->batch_size = 1;
 
     return self;
 }
 
 void obj_free(struct obj* self)
 {
-    if(self->type == OBJ_OBJECT && self->children)
+    if((self->type == OBJ_OBJECT || self->type == OBJ_ENUM) && self->children)
         obj_free(self->children); /* <- not tail recursion */
 
     struct obj* tail = self->next;
@@ -56,27 +58,84 @@ const char* obj_strtype(const struct obj* obj)
     case OBJ_OBJECT:  return "object";
     case OBJ_BOOL:    return "bool";
     case OBJ_ANY:     return "any";
+    case OBJ_ENUM:    return "enum";
     default:          break;
     }
     abort();
     return NULL;
 }
 
+static const char* number_strctype(const struct obj* obj)
+{
+    switch(obj->number)
+    {
+    case OBJ_NUMBER_I8:  return "int8_t";
+    case OBJ_NUMBER_I16: return "int16_t";
+    case OBJ_NUMBER_I32: return "int32_t";
+    case OBJ_NUMBER_I64: return "int64_t";
+    case OBJ_NUMBER_U8:  return "uint8_t";
+    case OBJ_NUMBER_U16: return "uint16_t";
+    case OBJ_NUMBER_U32: return "uint32_t";
+    case OBJ_NUMBER_U64: return "uint64_t";
+    case OBJ_NUMBER_F32: return "float";
+    case OBJ_NUMBER_F64: return "double";
+    default:             break;
+    }
+    return obj->type == OBJ_INTEGER ? "long long" : "double";
+}
+
 const char* obj_strctype(const struct obj* obj)
 {
     switch(obj->type)
     {
-    case OBJ_INTEGER: return "long long";
-    case OBJ_STRING:  return "char*";
-    case OBJ_REAL:    return "double";
+    case OBJ_INTEGER: return number_strctype(obj);
+    case OBJ_STRING:  return obj->is_interned ? "const char*" : "char*";
+    case OBJ_REAL:    return number_strctype(obj);
     case OBJ_OBJECT:  return "struct obj*";
     case OBJ_BOOL:    return "int";
+    case OBJ_ENUM:    return "int";
     default:          break;
     }
     abort();
     return NULL;
 }
 
+/* The limits are C expressions; NULL means that any value the lexer produces
+ * fits.
+ */
+const char* obj_strmin(const struct obj* obj)
+{
+    switch(obj->number)
+    {
+    case OBJ_NUMBER_I8:  return "INT8_MIN";
+    case OBJ_NUMBER_I16: return "INT16_MIN";
+    case OBJ_NUMBER_I32: return "INT32_MIN";
+    case OBJ_NUMBER_U8:  return "0";
+    case OBJ_NUMBER_U16: return "0";
+    case OBJ_NUMBER_U32: return "0";
+    case OBJ_NUMBER_U64: return "0";
+    case OBJ_NUMBER_F32: return "-FLT_MAX";
+    default:             break;
+    }
+    return NULL;
+}
+
+const char* obj_strmax(const struct obj* obj)
+{
+    switch(obj->number)
+    {
+    case OBJ_NUMBER_I8:  return "INT8_MAX";
+    case OBJ_NUMBER_I16: return "INT16_MAX";
+    case OBJ_NUMBER_I32: return "INT32_MAX";
+    case OBJ_NUMBER_U8:  return "UINT8_MAX";
+    case OBJ_NUMBER_U16: return "UINT16_MAX";
+    case OBJ_NUMBER_U32: return "UINT32_MAX";
+    case OBJ_NUMBER_F32: return "FLT_MAX";
+    default:             break;
+    }
+    return NULL;
+}
+
 void obj_dump(const struct obj* obj)
 {
     if(obj->type == OBJ_OBJECT)
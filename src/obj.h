@@ -27,17 +27,40 @@ enum obj_type {
     OBJ_REAL,
     OBJ_OBJECT,
     OBJ_BOOL,
-    OBJ_ANY
+    OBJ_ANY,
+    OBJ_ENUM
+};
+
+/* Storage of integer and real members; the default is long long or double */
+enum obj_number {
+    OBJ_NUMBER_DEFAULT = 0,
+    OBJ_NUMBER_I8,
+    OBJ_NUMBER_I16,
+    OBJ_NUMBER_I32,
+    OBJ_NUMBER_I64,
+    OBJ_NUMBER_U8,
+    OBJ_NUMBER_U16,
+    OBJ_NUMBER_U32,
+    OBJ_NUMBER_U64,
+    OBJ_NUMBER_F32,
+    OBJ_NUMBER_F64
 };
 
 struct obj {
     struct obj* next;
-    struct obj* children;
+    struct obj* children; /* members of objects, values of enums */
 
     enum obj_type type;
+    enum obj_number number;
     char name[256];
     ssize_t length;
+    int dimensions;
     int is_optional;
+    int is_stream;
+    long long batch_size;
+    int is_columnar;
+    int is_interned;
+    long long max_length; /* of inline strings, 0 if allocated */
 };
 
 struct obj_state {
@@ -60,6 +83,8 @@ struct obj* obj_new();
 void obj_free(struct obj* obj);
 const char* obj_strtype(const struct obj* obj);
 const char* obj_strctype(const struct obj* obj);
+const char* obj_strmin(const struct obj* obj);
+const char* obj_strmax(const struct obj* obj);
 void obj_dump(const struct obj* obj);
 
 #endif /* OBJ_H_INCLUDED_ */
@@ -0,0 +1,35 @@
+/*
+ * Copyright (c) 2015, Marel hf
+ * Copyright (c) 2015, Andri Yngvason
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+ * REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+ * INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+ * OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef TEMPLATES_H_INCLUDED_
+#define TEMPLATES_H_INCLUDED_
+
+#include <stdlib.h>
+
+/* Templates compiled into jsoncc as Lua bytecode, or as source text in cross
+ * builds, generated into templates.c by embed_templates. The list ends with
+ * an entry without a name.
+ */
+struct embedded_template {
+    const char* name;
+    const unsigned char* data;
+    size_t size;
+};
+
+extern const struct embedded_template embedded_templates[];
+
+#endif /* TEMPLATES_H_INCLUDED_ */
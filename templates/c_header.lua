@@ -14,20 +14,77 @@ local function append(t, text)
     t[#t+1] = text
 end
 
-local function gen_struct(obj, indent)
+local function element_name(path)
+    return name .. "_" .. table.concat(path, "__")
+end
+
+local function subpath(path, member)
+    local res = { unpack(path) }
+    res[#res+1] = member
+    return res
+end
+
+local function enum_value_name(type_name, value)
+    return string.upper(type_name .. "_" .. value)
+end
+
+local function gen_struct(obj, indent, path)
     local res = { }
 
     while obj do
-        if(obj.type == 'object') then
+        if(obj.is_columnar) then
             append_line(res, indent, "struct {")
-            append(res, gen_struct(obj.children, indent+1))
+            append_line(res, indent+1, "size_t reserved_size;")
+            append_line(res, indent+1, "size_t length;")
+            local column = obj.children
+            while column do
+                append_line(res, indent+1, column.ctype .. "* " .. column.name .. ";")
+                append_line(res, indent+1, "unsigned char* is_set_" .. column.name .. ";")
+                column = column.next
+            end
             append_line(res, indent, "} " .. obj.name .. ";")
+        elseif(obj.type == 'object' and obj.length == -1) then
+            append_line(res, indent, "size_t reserved_size_of_" .. obj.name .. ";")
+            append_line(res, indent, "size_t length_of_" .. obj.name .. ";")
+            append_line(res, indent, "struct " .. element_name(subpath(path, obj.name)) .. "* " .. obj.name .. ";")
+        elseif(obj.type == 'object') then
+            append_line(res, indent, "struct {")
+            append(res, gen_struct(obj.children, indent+1, subpath(path, obj.name)))
+            append_line(res, indent, "} " .. obj.name .. ";")
+        elseif(obj.type == 'enum') then
+            append_line(res, indent, "enum " .. element_name(subpath(path, obj.name)) .. " " .. obj.name .. ";")
         elseif(obj.type == 'any') then
             append_line(res, indent, "struct json_obj_any " .. obj.name .. ";")
+        elseif(obj.is_stream) then
+            append_line(res, indent, "struct {")
+            append_line(res, indent+1, "int (*fn)(void* ctx, const " .. obj.ctype .. "* elems, size_t n);")
+            append_line(res, indent+1, "void* ctx;")
+            append_line(res, indent+1, "size_t length;")
+            append_line(res, indent+1, "size_t batch_length;")
+            append_line(res, indent+1, obj.ctype .. " batch[" .. obj.batch_size .. "];")
+            append_line(res, indent, "} " .. obj.name .. ";")
+        elseif(obj.dimensions == 2) then
+            append_line(res, indent, "size_t reserved_size_of_" .. obj.name .. ";")
+            append_line(res, indent, "size_t length_of_" .. obj.name .. ";")
+            append_line(res, indent, obj.ctype .. "* " .. obj.name .. ";")
+            append_line(res, indent, "size_t reserved_rows_of_" .. obj.name .. ";")
+            append_line(res, indent, "size_t rows_of_" .. obj.name .. ";")
+            append_line(res, indent, "size_t* offsets_of_" .. obj.name .. ";")
         elseif(obj.length == -1) then
             append_line(res, indent, "size_t reserved_size_of_" .. obj.name .. ";")
             append_line(res, indent, "size_t length_of_" .. obj.name .. ";")
             append_line(res, indent, obj.ctype .. "* " .. obj.name .. ";")
+            if(obj.type == 'string') then
+                append_line(res, indent, "size_t* string_sizes_of_" .. obj.name .. ";")
+            end
+        elseif(obj.max_length > 0) then
+            append_line(res, indent, "char " .. obj.name .. "[" .. obj.max_length + 1 .. "];")
+            append_line(res, indent, "uint8_t length_of_" .. obj.name .. ";")
+        elseif(obj.is_interned) then
+            append_line(res, indent, obj.ctype .. " " .. obj.name .. ";")
+        elseif(obj.type == 'string') then
+            append_line(res, indent, "size_t reserved_size_of_" .. obj.name .. ";")
+            append_line(res, indent, obj.ctype .. " " .. obj.name .. ";")
         else
             append_line(res, indent, obj.ctype .. " " .. obj.name .. ";")
         end
@@ -39,18 +96,109 @@ local function gen_struct(obj, indent)
     return table.concat(res)
 end
 
+-- Elements of object arrays get a named structure each, declared before the
+-- structure which contains the array.
+local function gen_element_structs(obj, path)
+    local res = { }
+
+    while obj do
+        if(obj.type == 'object') then
+            local member_path = subpath(path, obj.name)
+            append(res, gen_element_structs(obj.children, member_path))
+
+            if(obj.length == -1 and not obj.is_columnar) then
+                append(res, "struct " .. element_name(member_path) .. " {\n")
+                append(res, gen_struct(obj.children, 1, member_path))
+                append(res, "};\n\n")
+            end
+        end
+
+        obj = obj.next
+    end
+
+    return table.concat(res)
+end
+
+local function gen_enums(obj, path)
+    local res = { }
+
+    while obj do
+        local member_path = subpath(path, obj.name)
+
+        if(obj.type == 'object') then
+            append(res, gen_enums(obj.children, member_path))
+        elseif(obj.type == 'enum') then
+            local type_name = element_name(member_path)
+            append(res, "enum " .. type_name .. " {\n")
+            local value = obj.children
+            while value do
+                append_line(res, 1, enum_value_name(type_name, value.name) .. ",")
+                value = value.next
+            end
+            append(res, "};\n\n")
+        end
+
+        obj = obj.next
+    end
+
+    return table.concat(res)
+end
+
+local function has_interned(obj)
+    while obj do
+        if(obj.is_interned or has_interned(obj.children)) then
+            return true
+        end
+        obj = obj.next
+    end
+    return false
+end
+
+-- Interned strings are looked up in a table owned by the caller.
+local intern_include = ""
+local intern_table = ""
+if(has_interned(JSON_ROOT)) then
+    intern_include = "#include <json_intern.h>\n"
+    intern_table = "\tstruct json_intern* intern_table;\n"
+end
+
 local output = {
 "#ifndef ", include_guard, "\n",
 "#define ", include_guard, "\n",
 "\n",
+"#include <stdint.h>\n",
 "#include <jslex.h>\n",
+"#include <json_buffer.h>\n",
+"#include <json_pool.h>\n",
+intern_include,
 "\n",
+gen_enums(JSON_ROOT, { }),
+gen_element_structs(JSON_ROOT, { }),
 "struct ", name, " {\n",
-    gen_struct(JSON_ROOT, 1),
+    gen_struct(JSON_ROOT, 1, { }),
+    intern_table,
+    "\tchar* lexer_buffer; /* kept by _unpack_reuse() */\n",
+    "\tsize_t lexer_buffer_size;\n",
 "};\n",
 "\n",
 "char* ", name, "_pack(const struct ", name, "*);\n",
+"size_t ", name, "_packed_size_hint(const struct ", name, "*);\n",
+"ssize_t ", name, "_pack_into(const struct ", name, "*, char* buffer, size_t size);\n",
+"ssize_t ", name, "_packed_size(const struct ", name, "*);\n",
+"ssize_t ", name, "_pack_stream(const struct ", name, "*,\n",
+"        int (*write)(void* ctx, const struct iovec* iov, int count), void* ctx);\n",
+"ssize_t ", name, "_pack_fd(const struct ", name, "*, int fd);\n",
+"char* ", name, "_pack_many(const struct ", name, "* items, size_t n);\n",
+"ssize_t ", name, "_pack_many_stream(const struct ", name, "* items, size_t n,\n",
+"        int (*write)(void* ctx, const struct iovec* iov, int count), void* ctx);\n",
+"ssize_t ", name, "_pack_many_fd(const struct ", name, "* items, size_t n, int fd);\n",
+"int ", name, "_pack_many_parallel(struct json_pool*, const struct ", name, "* items, size_t n,\n",
+"        struct json_batch*);\n",
+"ssize_t ", name, "_pack_many_parallel_fd(struct json_pool*, const struct ", name, "* items, size_t n,\n",
+"        int fd);\n",
 "ssize_t ", name, "_unpack(struct ", name, "*, const char* data);\n",
+"ssize_t ", name, "_unpack_reuse(struct ", name, "*, const char* data);\n",
+"void ", name, "_reset(struct ", name, "*);\n",
 "void ", name, "_cleanup(struct ", name, "*);\n",
 "\n",
 "#endif /* ", include_guard, " */\n",
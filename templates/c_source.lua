@@ -141,6 +141,18 @@ local function Isset(prefix, name)
     end
 end
 
+local function SetBit(bitmap, row)
+    return bitmap .. '[' .. row .. ' / 8] |= 1 << (' .. row .. ' % 8);\n'
+end
+
+local function ClearBit(bitmap, row)
+    return bitmap .. '[' .. row .. ' / 8] &= ~(1 << (' .. row .. ' % 8));\n'
+end
+
+local function IsBitSet(bitmap, row)
+    return 'JSON_COLUMN_IS_SET(' .. bitmap .. ', ' .. row .. ')'
+end
+
 local function get_current_value(prefix, name)
     if prefix then
         return "obj->" .. prefix .. '.' .. name
@@ -151,121 +163,418 @@ end
 
 local function get_current_length(prefix, name)
     if prefix then
-        return "obj->" .. prefix .. '.lengt_of_' .. name
+        return "obj->" .. prefix .. '.' .. name
     else
         return "obj->" .. name
     end
 end
 
+-- The unpack functions write to 'dst', which is either the root structure or,
+-- while generating the parser for the elements of an object array, the element
+-- structure. Member paths are relative to that structure.
+local dst_scope = { ctype = 'struct ' .. JSON_NAME, names = { } }
+
+local function dst_path(prefix, name)
+    local path = flatten{prefix}
+    local relative = { }
+    for i = #dst_scope.names + 1, #path do
+        relative[#relative+1] = path[i]
+    end
+    return myconcat('.', relative, name)
+end
+
+local function split_prefix(prefix)
+    local names = { }
+    if prefix then
+        for name in string.gmatch(prefix, '[^.]+') do
+            names[#names+1] = name
+        end
+    end
+    return names
+end
+
+-- Name of the element structure of an object array, given its absolute path.
+local function element_name(path)
+    return JSON_NAME .. '_' .. table.concat(flatten{path}, '__')
+end
+
+-- Same as above, but for members addressed through 'obj' in the current scope.
+local function current_element_name(prefix, name)
+    return element_name{dst_scope.names, split_prefix(prefix), name}
+end
+
+-- Length of the text that a C string literal stands for
+local function literal_length(str)
+    return #string.gsub(str, '\\(.)', '%1')
+end
+
+-- Output goes to 'out', a struct json_buffer which grows as needed. Text
+-- known at generation time is copied with a constant length.
 local function Append(fmt, ...)
     local t = {...}
     if #t == 0 then
-        return 'i += snprintf(&buffer[i], size-i, ' .. Str(fmt) .. ');\n' ..
-               If(Eq('i', 'size')) ..
+        return If('json_buffer_append_literal(out, ' .. Str(fmt) .. ', ' .. literal_length(fmt) .. ') < 0') ..
                    indent(Goto('failure'))
     else
-        return 'i += snprintf(&buffer[i], size-i, ' .. Str(fmt) .. ', '.. table.concat({...}, ', ') .. ');\n' ..
-               If(Eq('i', 'size')) ..
+        return If('json_buffer_printf(out, ' .. Str(fmt) .. ', ' .. table.concat(t, ', ') .. ') < 0') ..
                    indent(Goto('failure'))
    end
 end
 
+local function AppendJson(data, length)
+    return If('json_buffer_append_json(out, ' .. data .. ', ' .. length .. ') < 0') ..
+               indent(Goto('failure'))
+end
+
+-- Appends a number through one of the json_buffer_append_*() formatters
+local function AppendNumber(kind, value)
+    return If('json_buffer_append_' .. kind .. '(out, ' .. value .. ') < 0') ..
+               indent(Goto('failure'))
+end
+
 local function Declare(type, name)
     return type .. ' ' .. name .. ';\n'
 end
 
-local function AppendString(value)
-    return
-        Assign('str', 'json_string_encode(' .. value .. ', strlen(' .. value .. '))') ..
-        If(Not('str')) ..
-            indent(Goto('failure')) ..
-        Append('\\"%s\\"', 'str') ..
-        Free('str') ..
-        Assign('str', 'NULL')
+-- Strings are escaped straight into the output
+local function AppendString(value, length)
+    return If('json_buffer_append_string(out, ' .. value .. ', ' .. (length or 'strlen(' .. value .. ')') .. ') < 0') ..
+               indent(Goto('failure'))
 end
 
-local function gen_pack(obj, prefix)
-    local res = { }
-    local maybe_comma = IfThenElse(Neq(0, 'comma++'), Str(','), Str(''))
+local gen_pack
 
-    res[#res+1] = 'comma = 0;\n'
+-- Whether a comma goes before a key is known while generating the code,
+-- unless an optional member came first and nothing required since:
+--   'first'   - nothing has been written yet
+--   'later'   - a member has been written
+--   'unknown' - 'comma' tells whether a member has been written
+local function gen_pack_key(obj, state)
+    local key = '\\"' .. obj.name .. '\\":'
 
-    while obj do
-        local key = '\\"' .. obj.name .. '\\"'
+    if state == 'first' then
+        return Append(key)
+    elseif state == 'later' then
+        return Append(',' .. key)
+    end
 
-        local fn = match(obj.type) {
-            ['string'] = function(index) return
-                AppendString(get_current_value(prefix, obj.name) .. index)
-            end,
-            int = function(index) return
-                Append('%lld', get_current_value(prefix, obj.name) .. index)
-            end,
-            real = function(index) return
-                Append('%e', get_current_value(prefix, obj.name) .. index)
-            end,
-            bool = function(index) return
-                Append('%s', IfThenElse(get_current_value(prefix, obj.name) .. index, Str('true'), Str('false')))
-            end,
-            object = function() return
-                Append('{') ..
-                gen_pack(obj.children, get_new_prefix(prefix, obj.name)) ..
-                Append('}')
-            end,
-            any = function() return CodeBlock {
-                Switch(get_current_value(prefix, obj.name) .. '.type'),
-                CodeBlock {
-                    Case('JSON_OBJ_NULL', Append('null')),
-                    Case('JSON_OBJ_INTEGER', Append('%lld', get_current_value(prefix, obj.name) .. '.integer')),
-                    Case('JSON_OBJ_REAL', Append('%e', get_current_value(prefix, obj.name) .. '.real')),
-                    Case('JSON_OBJ_BOOL', Append('%s', IfThenElse(get_current_value(prefix, obj.name) .. '.boolean', Str('true'), Str('false')))),
-                    Case('JSON_OBJ_STRING', AppendString(get_current_value(prefix, obj.name) .. '.string_')),
-                    'default: break;'
-                }
+    return If('comma') ..
+           CodeBlock {
+               Append(',' .. key)
+           } ..
+           'else\n' ..
+           CodeBlock {
+               Append(key)
+           }
+end
+
+-- Members of columnar rows are packed with 'row' as the index into the column
+-- and the presence bitmap. Returns the code and the comma state after the
+-- member; 'is_last' tells whether 'comma' needs to be kept up to date.
+local function gen_pack_member(obj, prefix, row, state, is_last)
+    local res = { }
+
+    local fn = match(obj.type) {
+        ['string'] = function(index)
+            if obj.max_length > 0 then
+                return AppendString(get_current_value(prefix, obj.name),
+                                    get_current_length(prefix, 'length_of_' .. obj.name))
+            end
+            return AppendString(get_current_value(prefix, obj.name) .. index)
+        end,
+        int = function(index)
+            if obj.ctype == 'uint64_t' then
+                return AppendNumber('unsigned', get_current_value(prefix, obj.name) .. index)
+            end
+            return AppendNumber('integer', get_current_value(prefix, obj.name) .. index)
+        end,
+        real = function(index)
+            if obj.ctype == 'float' then
+                return AppendNumber('float', get_current_value(prefix, obj.name) .. index)
+            end
+            return AppendNumber('real', get_current_value(prefix, obj.name) .. index)
+        end,
+        bool = function(index) return
+            If(get_current_value(prefix, obj.name) .. index) ..
+            CodeBlock {
+                Append('true')
+            } ..
+            'else\n' ..
+            CodeBlock {
+                Append('false')
+            }
+        end,
+        enum = function(index)
+            local type_name = current_element_name(prefix, obj.name)
+            local strings = type_name .. '_strings_'
+            local value = get_current_value(prefix, obj.name) .. index
+            return If('(size_t)' .. value .. ' >= sizeof(' .. strings .. ') / sizeof(' .. strings .. '[0])') ..
+                       indent(Goto('failure')) ..
+                   If('json_buffer_append_literal(out, ' .. strings .. '[' .. value .. '], ' ..
+                      type_name .. '_lengths_[' .. value .. ']) < 0') ..
+                       indent(Goto('failure'))
+        end,
+        object = function(index)
+            if obj.length == -1 then
+                return If(current_element_name(prefix, obj.name) .. '_pack(&' ..
+                          get_current_value(prefix, obj.name) .. index .. ', out) < 0') ..
+                       indent(Goto('failure'))
+            end
+            return Append('{') ..
+                   gen_pack(obj.children, get_new_prefix(prefix, obj.name)) ..
+                   Append('}')
+        end,
+        any = function() return CodeBlock {
+            Switch(get_current_value(prefix, obj.name) .. '.type'),
+            CodeBlock {
+                Case('JSON_OBJ_NULL', Append('null')),
+                Case('JSON_OBJ_INTEGER', AppendNumber('integer', get_current_value(prefix, obj.name) .. '.integer')),
+                Case('JSON_OBJ_REAL', AppendNumber('real', get_current_value(prefix, obj.name) .. '.real')),
+                Case('JSON_OBJ_BOOL', Append('%s', IfThenElse(get_current_value(prefix, obj.name) .. '.boolean', Str('true'), Str('false')))),
+                Case('JSON_OBJ_STRING', AppendString(get_current_value(prefix, obj.name) .. '.string_')),
+                'case JSON_OBJ_OBJECT:\n',
+                Case('JSON_OBJ_ARRAY', AppendJson(get_current_value(prefix, obj.name) .. '.tape.text',
+                                                  get_current_value(prefix, obj.name) .. '.tape.text_length')),
+                'default: break;'
             }
-            end,
-            _ = function() error("whoops") end
         }
+        end,
+        _ = function() error("whoops") end
+    }
 
 
-        local array_wrap = function() return fn('') end
-        if obj.length == -1 then
-            local length = get_current_length(prefix, 'length_of_' .. obj.name)
-            array_wrap = function()
-                return CodeBlock {
+    local array_wrap = function() return fn(row and '[' .. row .. ']' or '') end
+    if obj.is_columnar then
+        local columns = get_current_value(prefix, obj.name)
+        local row_members = gen_pack(obj.children, get_new_prefix(prefix, obj.name), 'k')
+
+        array_wrap = function()
+            return CodeBlock {
+                Append('['),
+                Declare('size_t', 'k'),
+                For('k = 0', 'k < ' .. columns .. '.length', '++k'),
+                CodeBlock {
+                    If('k > 0'),
+                    CodeBlock {
+                        Append(',')
+                    },
+                    Append('{'),
+                    row_members,
+                    Append('}')
+                },
+                Append(']')
+            }
+        end
+    elseif obj.dimensions == 2 then
+        local rows = get_current_length(prefix, 'rows_of_' .. obj.name)
+        local offsets = get_current_value(prefix, 'offsets_of_' .. obj.name)
+        array_wrap = function()
+            return CodeBlock {
+                Append('['),
+                Declare('size_t', 'r'),
+                For('r = 0', 'r < ' .. rows, '++r'),
+                CodeBlock {
+                    If('r > 0'),
+                    CodeBlock {
+                        Append(',')
+                    },
                     Append('['),
-                    Declare('int', 'k'),
-                    If(length .. '> 0'),
+                    Declare('size_t', 'k'),
+                    For('k = ' .. offsets .. '[r]', 'k < ' .. offsets .. '[r + 1]', '++k'),
                     CodeBlock {
-                        fn('[0]'),
-                        For('k = 1', 'k < '  .. length, '++k'),
+                        If('k > ' .. offsets .. '[r]'),
                         CodeBlock {
-                            Append(','),
-                            fn('[k]')
+                            Append(',')
                         },
+                        fn('[k]')
                     },
                     Append(']')
+                },
+                Append(']')
+            }
+        end
+    elseif obj.length == -1 then
+        local length = get_current_length(prefix, 'length_of_' .. obj.name)
+        array_wrap = function()
+            return CodeBlock {
+                Append('['),
+                Declare('int', 'k'),
+                If(length .. '> 0'),
+                CodeBlock {
+                    fn('[0]'),
+                    For('k = 1', 'k < '  .. length, '++k'),
+                    CodeBlock {
+                        Append(','),
+                        fn('[k]')
+                    },
+                },
+                Append(']')
+            }
+        end
+    end
+
+    if obj.is_optional then
+        local isset = row and IsBitSet(get_current_value(prefix, 'is_set_' .. obj.name), row)
+                           or Isset(prefix, obj.name)
+        local set_comma = ''
+        if state ~= 'later' and not is_last then
+            set_comma = 'comma = 1;\n'
+        end
+        res[#res+1] = If(isset) ..
+        CodeBlock {
+            gen_pack_key(obj, state),
+            array_wrap(),
+            set_comma
+        }
+        if state == 'later' then
+            return table.concat(res), 'later'
+        end
+        return table.concat(res), 'unknown'
+    end
+
+    res[#res+1] = gen_pack_key(obj, state)
+    res[#res+1] = array_wrap()
+    return table.concat(res), 'later'
+end
+
+local function next_packed(obj)
+    obj = obj.next
+    while obj and obj.is_stream do
+        obj = obj.next
+    end
+    return obj
+end
+
+-- The members of an object, declaring 'comma' in a block of their own if it
+-- is needed.
+function gen_pack(obj, prefix, row)
+    local res = { }
+    local state = 'first'
+    local has_comma = false
+
+    while obj do
+        if not obj.is_stream then
+            local code
+            code, state = gen_pack_member(obj, prefix, row, state, not next_packed(obj))
+            res[#res+1] = code
+            has_comma = has_comma or state == 'unknown' and next_packed(obj) ~= nil
+        end
+
+        obj = obj.next
+    end
+
+    if has_comma then
+        return CodeBlock {
+            Declare('int', 'comma = 0'),
+            table.concat(res)
+        }
+    end
+    return table.concat(res)
+end
+
+local function scalar_size_hint(obj)
+    return match(obj.type) {
+        int = 20,
+        real = 24,
+        bool = 5,
+        enum = function()
+            local size = 0
+            local value = obj.children
+            while value do
+                size = math.max(size, #value.name + 2)
+                value = value.next
+            end
+            return size
+        end,
+        _ = 0
+    }
+end
+
+local function value_size_hint(obj)
+    local size = scalar_size_hint(obj)
+    return type(size) == 'function' and size() or size
+end
+
+-- Estimates the packed size of the members. Escapes in strings are not
+-- counted, so the estimate is low for strings that need many of them.
+local function gen_size_hint(obj, prefix)
+    local res = { }
+
+    while obj do
+        if not obj.is_stream then
+            local value = get_current_value(prefix, obj.name)
+            local member = { 'size += ', #obj.name + 4, ';\n' }
+
+            if obj.is_columnar then
+                local row_size = 2
+                local column = obj.children
+                while column do
+                    row_size = row_size + #column.name + 4 + value_size_hint(column)
+                    column = column.next
+                end
+                member[#member+1] = 'size += ' .. row_size .. ' * ' .. value .. '.length + 2;\n'
+            elseif obj.type == 'object' and obj.length == -1 then
+                member[#member+1] = CodeBlock {
+                    Declare('size_t', 'k'),
+                    For('k = 0', 'k < ' .. get_current_length(prefix, 'length_of_' .. obj.name), '++k'),
+                    '\n',
+                    '    size += ', current_element_name(prefix, obj.name), '_packed_size_hint(&', value, '[k]) + 1;\n'
                 }
+                member[#member+1] = 'size += 2;\n'
+            elseif obj.type == 'object' then
+                member[#member+1] = gen_size_hint(obj.children, get_new_prefix(prefix, obj.name))
+                member[#member+1] = 'size += 2;\n'
+            elseif obj.type == 'any' then
+                member[#member+1] = 'size += ' .. value .. '.tape.text_length + 24;\n'
+                member[#member+1] = If(Eq(value .. '.type', 'JSON_OBJ_STRING')) ..
+                                    indent('size += strlen(' .. value .. '.string_);\n')
+            elseif obj.type == 'string' and obj.length == -1 then
+                member[#member+1] = CodeBlock {
+                    Declare('size_t', 'k'),
+                    For('k = 0', 'k < ' .. get_current_length(prefix, 'length_of_' .. obj.name), '++k'),
+                    '\n',
+                    '    size += strlen(', value, '[k]) + 3;\n'
+                }
+                member[#member+1] = 'size += 2;\n'
+            elseif obj.type == 'string' and obj.max_length > 0 then
+                member[#member+1] = 'size += ' .. get_current_length(prefix, 'length_of_' .. obj.name) .. ' + 2;\n'
+            elseif obj.type == 'string' then
+                member[#member+1] = 'size += strlen(' .. value .. ') + 2;\n'
+            elseif obj.dimensions == 2 then
+                member[#member+1] = 'size += ' .. value_size_hint(obj) + 1 .. ' * ' ..
+                                    get_current_length(prefix, 'length_of_' .. obj.name) .. ' + 3 * ' ..
+                                    get_current_length(prefix, 'rows_of_' .. obj.name) .. ' + 2;\n'
+            elseif obj.length == -1 then
+                member[#member+1] = 'size += ' .. value_size_hint(obj) + 1 .. ' * ' ..
+                                    get_current_length(prefix, 'length_of_' .. obj.name) .. ' + 2;\n'
+            else
+                member[#member+1] = 'size += ' .. value_size_hint(obj) .. ';\n'
             end
-        end
 
-        if obj.is_optional then
-            res[#res+1] = If(Isset(prefix, obj.name)) ..
-            CodeBlock {
-                Append('%s' .. key .. ':', maybe_comma),
-                array_wrap()
-            }
-        else
-            res[#res+1] = Append('%s' .. key .. ':', maybe_comma)
-            res[#res+1] = array_wrap()
+            if obj.is_optional then
+                res[#res+1] = If(Isset(prefix, obj.name)) .. CodeBlock(member)
+            else
+                res[#res+1] = table.concat(member)
+            end
         end
 
-        is_first = false
         obj = obj.next
     end
 
     return table.concat(res)
 end
 
+local function gen_size_hint_function(obj, signature)
+    return signature .. '\n' ..
+    CodeBlock {
+        'size_t size = 2;\n',
+        '\n',
+        gen_size_hint(obj),
+        '\n',
+        'return size;\n'
+    } .. '\n'
+end
+
 local function gen_validate(obj, prefix)
     local res = { }
 
@@ -275,7 +584,7 @@ local function gen_validate(obj, prefix)
                 indent(Goto('failure'))
         end
 
-        if(obj.type == 'object') then
+        if(obj.type == 'object' and obj.length == 1) then
             if(obj.is_optional) then
                 res[#res+1] = If(Isset(prefix, obj.name)) ..
                     CodeBlock {
@@ -390,8 +699,9 @@ local function gen_unpack_any_value()
     CodeBlock {
         'return ', JSON_NAME, '_any_integer(any, lexer)\n',
         '    || ', JSON_NAME, '_any_real(any, lexer)\n',
-        '    || ', JSON_NAME, '_any_bool(any, lexer)\n',
-        '    || ', JSON_NAME, '_any_string(any, lexer);\n'
+        '    || ', JSON_NAME, '_any_literal(any, lexer)\n',
+        '    || ', JSON_NAME, '_any_string(any, lexer)\n',
+        '    || ', JSON_NAME, '_any_tape(any, lexer);\n'
     } .. '\n'
 end
 
@@ -416,11 +726,52 @@ local function gen_unpack_any_type(typename, token, json_type, assignment)
     return table.concat(res)
 end
 
+-- Objects and arrays are parsed onto the tape of the any value.
+local function gen_unpack_any_tape()
+    return 'static int ' .. JSON_NAME .. '_any_tape(struct json_obj_any* obj, struct jslex* lexer)\n' ..
+    CodeBlock {
+        'struct jslex_token* tok = jslex_next_token(lexer);\n',
+        'if(!tok)\n',
+        '    return 0;\n',
+        '\n',
+        'if(tok->type != JSLEX_LBRACE && tok->type != JSLEX_LBRACKET)\n',
+        '    return 0;\n',
+        '\n',
+        'if(json_tape_parse(&obj->tape, lexer) < 0)\n',
+        '    return 0;\n',
+        '\n',
+        'obj->type = json_tape_root(&obj->tape)->type;\n',
+        'return 1;\n'
+    } .. '\n'
+end
+
+local function gen_copy_string()
+    return 'static inline int ' .. JSON_NAME .. '_copy_string(char** dst, size_t* reserved, const char* src)\n' ..
+    CodeBlock {
+        'size_t size = strlen(src) + 1;\n',
+        '\n',
+        'if(!reserved || size > *reserved)\n',
+        CodeBlock {
+            'char* str = realloc(*dst, size);\n',
+            'if(!str)\n',
+            '    return -1;\n',
+            '\n',
+            '*dst = str;\n',
+            'if(reserved)\n',
+            '    *reserved = size;\n',
+        },
+        '\n',
+        'memcpy(*dst, src, size);\n',
+        'return 0;\n'
+    } .. '\n'
+end
+
 local function gen_unpack_primitive_tokens()
     local res = { }
 
     res[#res+1] = gen_expect()
     res[#res+1] = gen_match_key()
+    res[#res+1] = gen_copy_string()
     res[#res+1] = gen_match_primitive('lbracket', 'JSLEX_LBRACKET')
     res[#res+1] = gen_match_primitive('rbracket', 'JSLEX_RBRACKET')
     res[#res+1] = gen_match_primitive('lbrace', 'JSLEX_LBRACE')
@@ -441,10 +792,16 @@ local function gen_unpack_primitive_tokens()
         'obj->integer = tok->value.integer;')
     res[#res+1] = gen_unpack_any_type('real', 'JSLEX_REAL', 'JSON_OBJ_REAL',
         'obj->real = tok->value.real;')
-    res[#res+1] = gen_unpack_any_type('bool', 'JSLEX_LITERAL', 'JSON_OBJ_BOOL',
-        'obj->boolean = (strcmp(tok->value.str, "true") == 0);')
+    res[#res+1] = gen_unpack_any_type('literal', 'JSLEX_LITERAL', 'JSON_OBJ_BOOL',
+        'obj->boolean = (strcmp(tok->value.str, "true") == 0);\n' ..
+        'if(strcmp(tok->value.str, "null") == 0)\n' ..
+        '    obj->type = JSON_OBJ_NULL;\n' ..
+        'else if(!obj->boolean && strcmp(tok->value.str, "false") != 0)\n' ..
+        '    return 0;\n')
     res[#res+1] = gen_unpack_any_type('string', 'JSLEX_STRING', 'JSON_OBJ_STRING',
-        'obj->string_ = strdup(tok->value.str);')
+        'if(' .. JSON_NAME .. '_copy_string(&obj->string_, &obj->reserved_size_of_string_, tok->value.str) < 0)\n' ..
+        '    return 0;\n')
+    res[#res+1] = gen_unpack_any_tape()
     res[#res+1] = gen_unpack_any_value()
 
     return table.concat(res)
@@ -464,21 +821,22 @@ local function gen_unpack_object_members(obj, prefix)
     return 'return ' .. table.concat(values, '\n    || ') .. ';\n'
 end
 
-local function gen_unpack_object_value(obj, prefix)
+local function gen_unpack_object_value(obj, prefix, value_suffix)
     local full_prefix = myconcat('__', JSON_NAME, prefix, obj.name)
+    value_suffix = value_suffix or '_value'
     return table.concat{
-        'static int ', full_prefix, '_member(struct ', JSON_NAME, '* dst, struct jslex* lexer)\n',
+        'static int ', full_prefix, '_member(', dst_scope.ctype, '* dst, struct jslex* lexer)\n',
         CodeBlock {
             gen_unpack_object_members(obj, prefix)
         },
         '\n',
-        'static int ', full_prefix, '_members(struct ', JSON_NAME, '* dst, struct jslex* lexer)\n',
+        'static int ', full_prefix, '_members(', dst_scope.ctype, '* dst, struct jslex* lexer)\n',
         CodeBlock {
             'return ', full_prefix, '_member(dst, lexer) && (',
             JSON_NAME, '_comma(lexer) ? ', full_prefix, '_members(dst, lexer) : 1)\n;'
         },
         '\n',
-        'static int ', full_prefix, '_value(struct ', JSON_NAME, '* dst, struct jslex* lexer)\n',
+        'static int ', full_prefix, value_suffix, '(', dst_scope.ctype, '* dst, struct jslex* lexer)\n',
         CodeBlock {
             'return ', JSON_NAME, '_lbrace(lexer) && (', JSON_NAME, '_rbrace(lexer) || (',
                 full_prefix, '_members(dst, lexer) && ', JSON_NAME, '_rbrace(lexer)));\n'
@@ -489,13 +847,14 @@ end
 
 local function gen_unpack_object_object(obj, prefix)
     local full_prefix = myconcat('__', JSON_NAME, prefix, obj.name)
-    local isset_path = myconcat('.', prefix, 'is_set_' .. obj.name)
+    local isset_path = dst_path(prefix, 'is_set_' .. obj.name)
     return table.concat{
-        'static int ', full_prefix, '(struct ', JSON_NAME, '* dst, struct jslex* lexer)\n',
+        'static int ', full_prefix, '(', dst_scope.ctype, '* dst, struct jslex* lexer)\n',
         CodeBlock {
             'int res =  ', JSON_NAME, '_key(lexer, "', obj.name,'") && ',
             JSON_NAME, '_colon(lexer) && ', full_prefix, '_value(dst, lexer);\n',
-            'dst->', isset_path, ' = res;\n',
+            'if(res)\n',
+            '    dst->', isset_path, ' = 1;\n',
             'return res;\n'
         },
         '\n'
@@ -514,10 +873,10 @@ end
 
 local function gen_unpack_any(obj, prefix)
     local full_path = myconcat('__', JSON_NAME, prefix, obj.name)
-    local isset_path = myconcat('.', prefix, 'is_set_' .. obj.name)
-    local value_path = myconcat('.', prefix, obj.name)
+    local isset_path = dst_path(prefix, 'is_set_' .. obj.name)
+    local value_path = dst_path(prefix, obj.name)
     local res = {
-        'static int ', full_path, '(struct ', JSON_NAME, '* dst, struct jslex* lexer)\n',
+        'static int ', full_path, '(', dst_scope.ctype, '* dst, struct jslex* lexer)\n',
         CodeBlock {
             'if(!', JSON_NAME, '_key(lexer, "', obj.name,'"))\n',
             '    return 0;\n',
@@ -540,25 +899,111 @@ local function type_to_token(tp)
         int = 'JSLEX_INTEGER',
         real = 'JSLEX_REAL',
         string = 'JSLEX_STRING',
+        enum = 'JSLEX_STRING',
         bool = 'JSLEX_LITERAL',
         _ = 'ERROR'
     }
 end
 
+-- Integers above INT64_MAX are lexed as reals, which only u64 members accept.
+local function is_u64(obj)
+    return obj.type == 'int' and obj.ctype == 'uint64_t'
+end
+
+local function gen_token_check(obj)
+    local condition = 'tok->type != ' .. type_to_token(obj.type)
+    if is_u64(obj) then
+        condition = condition .. ' && !(tok->type == JSLEX_REAL && tok->big_integer)'
+    end
+
+    return 'if(' .. condition .. ')\n' ..
+           '    return 0;\n' ..
+           '\n'
+end
+
+local function gen_range_check(obj)
+    local value = match(obj.type) {
+        int = 'tok->value.integer',
+        real = 'tok->value.real',
+        _ = nil
+    }
+
+    if not value then
+        return ''
+    end
+
+    local bounds = { }
+    if obj.min then
+        bounds[#bounds+1] = value .. ' < ' .. obj.min
+    end
+    if obj.max then
+        bounds[#bounds+1] = value .. ' > ' .. obj.max
+    end
+
+    if #bounds == 0 then
+        return ''
+    end
+
+    local condition = table.concat(bounds, ' || ')
+    if is_u64(obj) then
+        condition = 'tok->type == JSLEX_INTEGER && ' .. condition
+    end
+
+    return 'if(' .. condition .. ')\n' ..
+           '    return 0;\n' ..
+           '\n'
+end
+
+local function token_integer(obj)
+    if is_u64(obj) then
+        return '(tok->type == JSLEX_INTEGER ? (uint64_t)tok->value.integer : tok->big_integer)'
+    end
+    return 'tok->value.integer'
+end
+
 local function gen_assign_integer(obj, prefix)
-    return 'dst->' .. myconcat('.', prefix, obj.name) .. ' = tok->value.integer;\n'
+    return 'dst->' .. dst_path(prefix, obj.name) .. ' = ' .. token_integer(obj) .. ';\n'
 end
 
 local function gen_assign_real(obj, prefix)
-    return 'dst->' .. myconcat('.', prefix, obj.name) .. ' = tok->value.real;\n'
+    return 'dst->' .. dst_path(prefix, obj.name) .. ' = tok->value.real;\n'
+end
+
+-- Inline strings are copied straight from the lexer, so values which are too
+-- long are rejected before anything is written.
+local function gen_assign_inline_string(obj, prefix)
+    local value = 'dst->' .. dst_path(prefix, obj.name)
+    return 'size_t length = strlen(tok->value.str);\n' ..
+           'if(length > ' .. obj.max_length .. ')\n' ..
+           '    return 0;\n' ..
+           '\n' ..
+           'memcpy(' .. value .. ', tok->value.str, length + 1);\n' ..
+           'dst->' .. dst_path(prefix, 'length_of_' .. obj.name) .. ' = length;\n'
 end
 
 local function gen_assign_string(obj, prefix)
-    return 'dst->' .. myconcat('.', prefix, obj.name) .. ' = strdup(tok->value.str);\n'
+    if obj.max_length > 0 then
+        return gen_assign_inline_string(obj, prefix)
+    end
+    if obj.is_interned then
+        local value = 'dst->' .. dst_path(prefix, obj.name)
+        return value .. ' = json_intern(lexer->intern, tok->value.str, strlen(tok->value.str));\n' ..
+               'if(!' .. value .. ')\n' ..
+               '    return 0;\n'
+    end
+    return 'if(' .. JSON_NAME .. '_copy_string(&dst->' .. dst_path(prefix, obj.name) ..
+           ', &dst->' .. dst_path(prefix, 'reserved_size_of_' .. obj.name) .. ', tok->value.str) < 0)\n' ..
+           '    return 0;\n'
 end
 
 local function gen_assign_bool(obj, prefix)
-    return 'dst->' .. myconcat('.', prefix, obj.name) .. ' = (strcmp(tok->value.str, "true") == 0);\n'
+    return 'dst->' .. dst_path(prefix, obj.name) .. ' = (strcmp(tok->value.str, "true") == 0);\n'
+end
+
+local function gen_assign_enum(obj, prefix)
+    return 'if(' .. element_name{prefix, obj.name} .. '_from_string(tok->value.str, &dst->' ..
+           dst_path(prefix, obj.name) .. ') < 0)\n' ..
+           '    return 0;\n'
 end
 
 local function gen_assign_simple_value(obj, prefix)
@@ -566,29 +1011,100 @@ local function gen_assign_simple_value(obj, prefix)
         int = gen_assign_integer,
         real = gen_assign_real,
         string = gen_assign_string,
-        bool = gen_assign_bool
+        bool = gen_assign_bool,
+        enum = gen_assign_enum
     } (obj, prefix)
 end
 
+local function enum_values(obj)
+    local values = { }
+    local value = obj.children
+    while value do
+        values[#values+1] = value.name
+        value = value.next
+    end
+    return values
+end
+
+-- Enum values are matched by length first, so at most a few candidates are
+-- compared for each token.
+local function gen_enum_functions(obj, prefix)
+    local type_name = element_name{prefix, obj.name}
+    local values = enum_values(obj)
+    local by_length = { }
+    local lengths = { }
+
+    for _, value in ipairs(values) do
+        if not by_length[#value] then
+            by_length[#value] = { }
+            lengths[#lengths+1] = #value
+        end
+        table.insert(by_length[#value], value)
+    end
+    table.sort(lengths)
+
+    local cases = { }
+    for _, length in ipairs(lengths) do
+        local tests = { }
+        for _, value in ipairs(by_length[length]) do
+            tests[#tests+1] = If('memcmp(str, "' .. value .. '", ' .. length .. ') == 0') ..
+                CodeBlock {
+                    '*value = ', string.upper(type_name .. '_' .. value), ';\n',
+                    'return 0;\n'
+                }
+        end
+        cases[#cases+1] = Case(length, table.concat(tests))
+    end
+
+    -- Values are packed with their quotes, straight from these tables
+    local strings = { }
+    local string_lengths = { }
+    for i, value in ipairs(values) do
+        strings[i] = '"\\"' .. value .. '\\""'
+        string_lengths[i] = #value + 2
+    end
+
+    return table.concat {
+        'static const char* const ', type_name, '_strings_[] = {\n',
+        '    ', table.concat(strings, ',\n    '), '\n',
+        '};\n',
+        '\n',
+        'static const size_t ', type_name, '_lengths_[] = {\n',
+        '    ', table.concat(string_lengths, ', '), '\n',
+        '};\n',
+        '\n',
+        'static int ', type_name, '_from_string(const char* str, enum ', type_name, '* value)\n',
+        CodeBlock {
+            Switch('strlen(str)'),
+            CodeBlock {
+                table.concat(cases),
+                'default: break;\n'
+            },
+            '\n',
+            'return -1;\n'
+        },
+        '\n'
+    }
+end
+
 local function gen_unpack_simple(obj, prefix)
     local res = {
-        'static int ', myconcat('__', JSON_NAME, prefix, obj.name), '_value(struct ', JSON_NAME, '* dst, struct jslex* lexer)\n',
+        'static int ', myconcat('__', JSON_NAME, prefix, obj.name), '_value(', dst_scope.ctype, '* dst, struct jslex* lexer)\n',
         CodeBlock {
             'struct jslex_token* tok = jslex_next_token(lexer);\n',
             'if(!tok)\n',
             '    return 0;\n',
             '\n',
-            'if(tok->type != ', type_to_token(obj.type), ')\n',
-            '    return 0;\n',
-            '\n',
+            gen_token_check(obj),
+            gen_range_check(obj),
             gen_assign_simple_value(obj, prefix),
-            'dst->', myconcat('.', prefix, 'is_set_' .. obj.name), ' = 1;\n',
+            'dst->', dst_path(prefix, 'is_set_' .. obj.name), ' = 1;\n',
             '\n',
             'jslex_accept_token(lexer);\n',
             'return 1;\n'
         },
         '\n',
-        'static int ', myconcat('__', JSON_NAME, prefix, obj.name), '(struct ', JSON_NAME, '* dst, struct jslex* lexer)\n',
+        'static int ', myconcat('__', JSON_NAME, prefix, obj.name), '(', dst_scope.ctype, '* dst, struct jslex* lexer)\n',
         CodeBlock {
             'return ', JSON_NAME, '_key(lexer, "', obj.name,'") && ',
             JSON_NAME, '_colon(lexer) && ',
@@ -600,26 +1116,63 @@ end
 
 local function gen_grow_and_append_array(obj, prefix)
     local full_path = myconcat('__', JSON_NAME, prefix, obj.name)
-    local reserved_size = myconcat('.', prefix, 'reserved_size_of_' .. obj.name)
-    local length = myconcat('.', prefix, 'length_of_' .. obj.name)
-    local value_path = myconcat('.', prefix, obj.name)
+    local reserved_size = dst_path(prefix, 'reserved_size_of_' .. obj.name)
+    local length = dst_path(prefix, 'length_of_' .. obj.name)
+    local value_path = dst_path(prefix, obj.name)
+    local ctype = obj.ctype
+    if obj.type == 'object' then
+        ctype = 'struct ' .. element_name{prefix, obj.name}
+    end
+
+    -- Unused string and object slots are kept zeroed so that reused buffers
+    -- can be told apart from garbage.
+    local clear_new_slots = ''
+    if obj.type == 'string' or obj.type == 'object' then
+        clear_new_slots = 'memset(&values[dst->' .. reserved_size .. '], 0, sizeof(' .. ctype ..
+                          ') * (new_size * 2 - dst->' .. reserved_size .. '));\n'
+    end
+
+    -- String elements remember the size of their buffer so that reuse only
+    -- reallocates strings which got longer.
+    local grow_string_sizes = ''
+    if obj.type == 'string' then
+        local sizes_path = dst_path(prefix, 'string_sizes_of_' .. obj.name)
+        grow_string_sizes = table.concat {
+            '\n',
+            'size_t* sizes = realloc(dst->', sizes_path, ', sizeof(size_t) * new_size * 2);\n',
+            'if(!sizes)\n',
+            '    return -1;\n',
+            '\n',
+            'memset(&sizes[dst->', reserved_size, '], 0, sizeof(size_t) * (new_size * 2 - dst->', reserved_size, '));\n',
+            'dst->', sizes_path, ' = sizes;\n'
+        }
+    end
 
     local res = {
-        'static int ', full_path, '_grow(struct ', JSON_NAME, '* dst, size_t new_size)\n',
+        'static int ', full_path, '_grow(', dst_scope.ctype, '* dst, size_t new_size)\n',
         CodeBlock {
             'if(new_size <= dst->', reserved_size, ')\n',
             '    return 0;\n',
-            'else\n',
-            '    dst->', reserved_size, ' = new_size * 2;\n',
             '\n',
-            'dst->', value_path, ' = realloc(dst->', value_path, ', sizeof(', obj.ctype, ') * dst->', reserved_size, ');\n',
-            'if(!dst->', value_path, ')\n',
+            ctype, '* values = realloc(dst->', value_path, ', sizeof(', ctype, ') * new_size * 2);\n',
+            'if(!values)\n',
             '    return -1;\n',
             '\n',
+            clear_new_slots,
+            'dst->', value_path, ' = values;\n',
+            grow_string_sizes,
+            'dst->', reserved_size, ' = new_size * 2;\n',
             'return 0;\n'
         },
-        '\n',
-        'static int ', full_path, '_append(struct ', JSON_NAME, '* dst, ', obj.ctype, ' elem)\n',
+        '\n'
+    }
+
+    if obj.type == 'string' or obj.type == 'object' then
+        return table.concat(res)
+    end
+
+    res[#res+1] = table.concat {
+        'static int ', full_path, '_append(', dst_scope.ctype, '* dst, ', obj.ctype, ' elem)\n',
         CodeBlock {
             'if(', full_path, '_grow(dst, dst->', length, ' + 1) < 0)\n',
             '    return -1;\n',
@@ -634,8 +1187,47 @@ local function gen_grow_and_append_array(obj, prefix)
     return table.concat(res)
 end
 
+local function gen_stream_flush_and_append(obj, prefix)
+    if #dst_scope.names > 0 then
+        error(obj.name .. ": streams are not supported inside object arrays")
+    end
+
+    local full_path = myconcat('__', JSON_NAME, prefix, obj.name)
+    local value_path = dst_path(prefix, obj.name)
+
+    local res = {
+        'static int ', full_path, '_flush(', dst_scope.ctype, '* dst)\n',
+        CodeBlock {
+            'size_t n = dst->', value_path, '.batch_length;\n',
+            'dst->', value_path, '.batch_length = 0;\n',
+            '\n',
+            'if(!dst->', value_path, '.fn)\n',
+            '    return -1;\n',
+            '\n',
+            'if(n == 0)\n',
+            '    return 0;\n',
+            '\n',
+            'return dst->', value_path, '.fn(dst->', value_path, '.ctx, dst->', value_path, '.batch, n) == 0 ? 0 : -1;\n'
+        },
+        '\n',
+        'static int ', full_path, '_append(', dst_scope.ctype, '* dst, ', obj.ctype, ' elem)\n',
+        CodeBlock {
+            'dst->', value_path, '.batch[dst->', value_path, '.batch_length++] = elem;\n',
+            'dst->', value_path, '.length++;\n',
+            '\n',
+            'if(dst->', value_path, '.batch_length < ', obj.batch_size, ')\n',
+            '    return 0;\n',
+            '\n',
+            'return ', full_path, '_flush(dst);\n'
+        },
+        '\n'
+    }
+
+    return table.concat(res)
+end
+
 local function gen_append_integer(obj, prefix)
-    return 'if(' .. myconcat('__', JSON_NAME, prefix, obj.name) .. '_append(dst, tok->value.integer) < 0)\n' ..
+    return 'if(' .. myconcat('__', JSON_NAME, prefix, obj.name) .. '_append(dst, ' .. token_integer(obj) .. ') < 0)\n' ..
             '    return 0;\n'
 end
 
@@ -645,16 +1237,16 @@ local function gen_append_real(obj, prefix)
 end
 
 local function gen_append_string(obj, prefix)
+    local length = 'dst->' .. dst_path(prefix, 'length_of_' .. obj.name)
     local res = {
-        'char* copy = strdup(tok->value.str);\n',
-        'if(!copy)\n',
+        'if(', myconcat('__', JSON_NAME, prefix, obj.name), '_grow(dst, ', length, ' + 1) < 0)\n',
         '    return 0;\n',
         '\n',
-        'if(', myconcat('__', JSON_NAME, prefix, obj.name) .. '_append(dst, copy) < 0)\n',
-        CodeBlock {
-            'free(copy);\n',
-            'return 0;\n',
-        },
+        'if(', JSON_NAME, '_copy_string(&dst->', dst_path(prefix, obj.name), '[', length, '],\n',
+        '        &dst->', dst_path(prefix, 'string_sizes_of_' .. obj.name), '[', length, '], tok->value.str) < 0)\n',
+        '    return 0;\n',
+        '\n',
+        length, '++;\n'
     }
     return table.concat(res)
 end
@@ -673,41 +1265,138 @@ local function gen_append_array_value(obj, prefix)
     } (obj, prefix)
 end
 
-local function gen_unpack_array_values(obj, prefix)
+local function gen_unpack_array_value(obj, prefix)
+    return CodeBlock {
+        'struct jslex_token* tok = jslex_next_token(lexer);\n',
+        'if(!tok)\n',
+        '    return 0;\n',
+        '\n',
+        gen_token_check(obj),
+        gen_range_check(obj),
+        gen_append_array_value(obj, prefix),
+        '\n',
+        'jslex_accept_token(lexer);\n',
+        'return 1;\n'
+    }
+end
+
+-- Elements are parsed straight into the next slot of the array, which keeps
+-- the buffers of whatever element was stored there before.
+local function gen_unpack_object_array_value(obj, prefix)
     local full_path = myconcat('__', JSON_NAME, prefix, obj.name)
-    local isset_path = myconcat('.', prefix, 'is_set_' .. obj.name)
+    local length = 'dst->' .. dst_path(prefix, 'length_of_' .. obj.name)
+    local name = element_name{prefix, obj.name}
 
-    local res = {
-        'static int ', full_path, '_value(struct ', JSON_NAME, '* dst, struct jslex* lexer)\n',
-        CodeBlock {
-            'struct jslex_token* tok = jslex_next_token(lexer);\n',
-            'if(!tok)\n',
-            '    return 0;\n',
-            '\n',
-            'if(tok->type != ', type_to_token(obj.type), ')\n',
-            '    return 0;\n',
-            '\n',
-            gen_append_array_value(obj, prefix),
-            '\n',
-            'jslex_accept_token(lexer);\n',
-            'return 1;\n'
-        },
+    return CodeBlock {
+        'if(', full_path, '_grow(dst, ', length, ' + 1) < 0)\n',
+        '    return 0;\n',
+        '\n',
+        'struct ', name, '* elem = &dst->', dst_path(prefix, obj.name), '[', length, '];\n',
+        name, '_reset(elem);\n',
+        '\n',
+        'if(!', full_path, '_object(elem, lexer) || !', name, '_validate(elem))\n',
+        '    return 0;\n',
+        '\n',
+        length, '++;\n',
+        'return 1;\n'
+    }
+end
+
+-- The members of a columnar row are parsed straight into their columns at
+-- the row which follows the last one.
+local function gen_unpack_columnar_row_value(obj, prefix)
+    local full_path = myconcat('__', JSON_NAME, prefix, obj.name)
+    local columns = 'dst->' .. dst_path(prefix, obj.name)
+    local clear, check = { }, { }
+
+    local column = obj.children
+    while column do
+        clear[#clear+1] = ClearBit(columns .. '.is_set_' .. column.name, 'row')
+        if not column.is_optional then
+            check[#check+1] = If(Not(IsBitSet(columns .. '.is_set_' .. column.name, 'row'))) ..
+                              '    return 0;\n'
+        end
+        column = column.next
+    end
+
+    return CodeBlock {
+        'if(', full_path, '_grow(dst, ', columns, '.length + 1) < 0)\n',
+        '    return 0;\n',
+        '\n',
+        'size_t row = ', columns, '.length;\n',
+        table.concat(clear),
+        '\n',
+        'if(!', full_path, '_object(dst, lexer))\n',
+        '    return 0;\n',
+        '\n',
+        table.concat(check),
+        #check > 0 and '\n' or '',
+        columns, '.length++;\n',
+        'return 1;\n'
+    }
+end
+
+-- Rows of nested arrays are appended to the shared values buffer, and the end
+-- of each row is recorded in the offsets, which start with a zero.
+local function gen_unpack_nested_row_value(obj, prefix)
+    local full_path = myconcat('__', JSON_NAME, prefix, obj.name)
+    local length = 'dst->' .. dst_path(prefix, 'length_of_' .. obj.name)
+    local rows = 'dst->' .. dst_path(prefix, 'rows_of_' .. obj.name)
+    local offsets = 'dst->' .. dst_path(prefix, 'offsets_of_' .. obj.name)
+
+    return CodeBlock {
+        'if(', full_path, '_grow_rows(dst, ', rows, ' + 1) < 0)\n',
+        '    return 0;\n',
+        '\n',
+        offsets, '[', rows, '] = ', length, ';\n',
+        '\n',
+        'if(!(', JSON_NAME, '_lbracket(lexer) && (', JSON_NAME, '_rbracket(lexer) || (',
+        full_path, '_elements(dst, lexer) && ', JSON_NAME, '_rbracket(lexer)))))\n',
+        '    return 0;\n',
+        '\n',
+        offsets, '[++', rows, '] = ', length, ';\n',
+        'return 1;\n'
+    }
+end
+
+local function gen_unpack_array_values(obj, prefix)
+    local full_path = myconcat('__', JSON_NAME, prefix, obj.name)
+    local isset_path = dst_path(prefix, 'is_set_' .. obj.name)
+    local value
+    if obj.dimensions == 2 then
+        value = gen_unpack_nested_row_value(obj, prefix)
+    elseif obj.is_columnar then
+        value = gen_unpack_columnar_row_value(obj, prefix)
+    elseif obj.type == 'object' then
+        value = gen_unpack_object_array_value(obj, prefix)
+    else
+        value = gen_unpack_array_value(obj, prefix)
+    end
+
+    local res = {
+        'static int ', full_path, '_value(', dst_scope.ctype, '* dst, struct jslex* lexer)\n',
+        value,
         '\n',
-        'static int ', full_path, '_values(struct ', JSON_NAME, '* dst, struct jslex* lexer)\n',
+        'static int ', full_path, '_values(', dst_scope.ctype, '* dst, struct jslex* lexer)\n',
         CodeBlock {
-            'return ', full_path, '_value(dst, lexer) && (',
-            JSON_NAME, '_comma(lexer) ? ', full_path, '_values(dst, lexer) : 1);\n'
+            'do\n',
+            '    if(!', full_path, '_value(dst, lexer))\n',
+            '        return 0;\n',
+            'while(', JSON_NAME, '_comma(lexer));\n',
+            '\n',
+            'return 1;\n'
         },
         '\n',
-        'static int ', full_path, '_array(struct ', JSON_NAME, '* dst, struct jslex* lexer)\n',
+        'static int ', full_path, '_array(', dst_scope.ctype, '* dst, struct jslex* lexer)\n',
         CodeBlock {
             'int res = ', JSON_NAME, '_lbracket(lexer) && (', JSON_NAME, '_rbracket(lexer) || (',
-            full_path, '_values(dst, lexer) && ', JSON_NAME, '_rbracket(lexer)));\n',
+            full_path, '_values(dst, lexer) && ', JSON_NAME, '_rbracket(lexer)))',
+            obj.is_stream and ('\n    && ' .. full_path .. '_flush(dst) == 0') or '', ';\n',
             'dst->', isset_path, ' = res;\n',
             'return res;\n'
         },
         '\n',
-        'static int ', full_path, '(struct ', JSON_NAME, '* dst, struct jslex* lexer)\n',
+        'static int ', full_path, '(', dst_scope.ctype, '* dst, struct jslex* lexer)\n',
         CodeBlock {
             'return ', JSON_NAME, '_key(lexer, "', obj.name,'") && ',
             JSON_NAME, '_colon(lexer) && ', full_path, '_array(dst, lexer);\n'
@@ -717,21 +1406,229 @@ local function gen_unpack_array_values(obj, prefix)
     return table.concat(res)
 end
 
+local function gen_unpack_nested_array(obj, prefix)
+    local full_path = myconcat('__', JSON_NAME, prefix, obj.name)
+    local reserved_rows = dst_path(prefix, 'reserved_rows_of_' .. obj.name)
+    local offsets = dst_path(prefix, 'offsets_of_' .. obj.name)
+
+    local res = {
+        gen_grow_and_append_array(obj, prefix),
+        'static int ', full_path, '_grow_rows(', dst_scope.ctype, '* dst, size_t new_rows)\n',
+        CodeBlock {
+            'if(new_rows < dst->', reserved_rows, ')\n',
+            '    return 0;\n',
+            '\n',
+            'size_t* offsets = realloc(dst->', offsets, ', sizeof(size_t) * (new_rows + 1) * 2);\n',
+            'if(!offsets)\n',
+            '    return -1;\n',
+            '\n',
+            'dst->', offsets, ' = offsets;\n',
+            'dst->', reserved_rows, ' = (new_rows + 1) * 2;\n',
+            'return 0;\n'
+        },
+        '\n',
+        'static int ', full_path, '_element(', dst_scope.ctype, '* dst, struct jslex* lexer)\n',
+        gen_unpack_array_value(obj, prefix),
+        '\n',
+        'static int ', full_path, '_elements(', dst_scope.ctype, '* dst, struct jslex* lexer)\n',
+        CodeBlock {
+            'do\n',
+            '    if(!', full_path, '_element(dst, lexer))\n',
+            '        return 0;\n',
+            'while(', JSON_NAME, '_comma(lexer));\n',
+            '\n',
+            'return 1;\n'
+        },
+        '\n',
+        gen_unpack_array_values(obj, prefix)
+    }
+    return table.concat(res)
+end
+
 local function gen_unpack_array(obj, prefix)
+    if obj.dimensions == 2 then
+        return gen_unpack_nested_array(obj, prefix)
+    end
+
     local res = {
+        obj.is_stream and gen_stream_flush_and_append(obj, prefix)
+                       or gen_grow_and_append_array(obj, prefix),
+        gen_unpack_array_values(obj, prefix)
+    }
+    return table.concat(res)
+end
+
+local gen_cleanup, gen_reset
+
+-- Generates the parser and the reset, cleanup, validate and pack functions for
+-- the element structure of an object array.
+local function gen_element_functions(obj, prefix)
+    local path = flatten{prefix, obj.name}
+    local name = element_name(path)
+    local outer_scope = dst_scope
+    dst_scope = { ctype = 'struct ' .. name, names = path }
+
+    local validate = gen_validate(obj.children)
+    if validate ~= '' then
+        validate = indent(validate) .. '    return 1;\n\n' .. Mark('failure') .. '    return 0;\n'
+    else
+        validate = '    return 1;\n'
+    end
+
+    local res = {
+        gen_unpack_object_functions(obj.children, path),
+        gen_unpack_object_value(obj, prefix, '_object'),
+        'static void ', name, '_reset(struct ', name, '* obj)\n',
+        CodeBlock {
+            gen_reset(obj.children)
+        },
+        '\n',
+        'static void ', name, '_cleanup(struct ', name, '* obj)\n',
+        CodeBlock {
+            gen_cleanup(obj.children)
+        },
+        '\n',
+        'static int ', name, '_validate(const struct ', name, '* obj)\n',
+        '{\n',
+        validate,
+        '}\n',
+        '\n',
+        gen_size_hint_function(obj.children, 'static size_t ' .. name .. '_packed_size_hint(const struct ' .. name .. '* obj)'),
+        'static int ', name, '_pack(const struct ', name, '* obj, struct json_buffer* out)\n',
+        '{\n',
+        indent(Append('{') .. gen_pack(obj.children) .. Append('}')),
+        '    return 0;\n',
+        '\n',
+        Mark('failure'),
+        '    return -1;\n',
+        '}\n',
+        '\n'
+    }
+
+    dst_scope = outer_scope
+    return table.concat(res)
+end
+
+local function gen_unpack_object_array(obj, prefix)
+    local res = {
+        gen_element_functions(obj, prefix),
         gen_grow_and_append_array(obj, prefix),
         gen_unpack_array_values(obj, prefix)
     }
     return table.concat(res)
 end
 
+local function token_value(obj)
+    return match(obj.type) {
+        int = token_integer(obj),
+        real = 'tok->value.real',
+        bool = '(strcmp(tok->value.str, "true") == 0)'
+    }
+end
+
+local function gen_grow_columns(obj, prefix)
+    local full_path = myconcat('__', JSON_NAME, prefix, obj.name)
+    local columns = 'dst->' .. dst_path(prefix, obj.name)
+    local res = { }
+
+    local column = obj.children
+    while column do
+        local values = columns .. '.' .. column.name
+        local bitmap = columns .. '.is_set_' .. column.name
+        res[#res+1] = CodeBlock {
+            column.ctype, '* values = realloc(', values, ', sizeof(', column.ctype, ') * reserved_size);\n',
+            'if(!values)\n',
+            '    return -1;\n',
+            '\n',
+            values, ' = values;\n',
+            '\n',
+            'unsigned char* bitmap = realloc(', bitmap, ', (reserved_size + 7) / 8);\n',
+            'if(!bitmap)\n',
+            '    return -1;\n',
+            '\n',
+            bitmap, ' = bitmap;\n'
+        }
+        column = column.next
+    end
+
+    return table.concat {
+        'static int ', full_path, '_grow(', dst_scope.ctype, '* dst, size_t new_size)\n',
+        CodeBlock {
+            'if(new_size <= ', columns, '.reserved_size)\n',
+            '    return 0;\n',
+            '\n',
+            'size_t reserved_size = new_size * 2;\n',
+            '\n',
+            table.concat(res),
+            '\n',
+            columns, '.reserved_size = reserved_size;\n',
+            'return 0;\n'
+        },
+        '\n'
+    }
+end
+
+local function gen_unpack_column(column, prefix)
+    local full_path = myconcat('__', JSON_NAME, prefix, column.name)
+    local columns = 'dst->' .. dst_path(prefix)
+    local row = columns .. '.length'
+
+    return table.concat {
+        'static int ', full_path, '_value(', dst_scope.ctype, '* dst, struct jslex* lexer)\n',
+        CodeBlock {
+            'struct jslex_token* tok = jslex_next_token(lexer);\n',
+            'if(!tok)\n',
+            '    return 0;\n',
+            '\n',
+            gen_token_check(column),
+            gen_range_check(column),
+            columns, '.', column.name, '[', row, '] = ', token_value(column), ';\n',
+            SetBit(columns .. '.is_set_' .. column.name, row),
+            '\n',
+            'jslex_accept_token(lexer);\n',
+            'return 1;\n'
+        },
+        '\n',
+        'static int ', full_path, '(', dst_scope.ctype, '* dst, struct jslex* lexer)\n',
+        CodeBlock {
+            'return ', JSON_NAME, '_key(lexer, "', column.name,'") && ',
+            JSON_NAME, '_colon(lexer) && ', full_path, '_value(dst, lexer);\n'
+        }, '\n'
+    }
+end
+
+local function gen_unpack_columnar(obj, prefix)
+    local res = { gen_grow_columns(obj, prefix) }
+
+    local column = obj.children
+    while column do
+        res[#res+1] = gen_unpack_column(column, flatten{prefix, obj.name})
+        column = column.next
+    end
+
+    res[#res+1] = gen_unpack_object_value(obj, prefix, '_object')
+    res[#res+1] = gen_unpack_array_values(obj, prefix)
+
+    return table.concat(res)
+end
+
 function gen_unpack_object_functions(obj, prefix)
     local res = { }
 
     while obj do
         res[#res+1] = match(obj.type) {
-            object = gen_unpack_object,
+            object = function(...)
+                if(obj.is_columnar) then
+                    return gen_unpack_columnar(...)
+                elseif(obj.length == -1) then
+                    return gen_unpack_object_array(...)
+                end
+                return gen_unpack_object(...)
+            end,
             any = gen_unpack_any,
+            enum = function(...)
+                return gen_enum_functions(...) .. gen_unpack_simple(...)
+            end,
             _ = function(...)
                 if(obj.length == 1) then
                     return gen_unpack_simple(...)
@@ -760,60 +1657,84 @@ end
 
 local function gen_cleanup_dynamic_string_array(prefix, obj)
     local full_path = get_current_value(prefix, obj.name)
-    local length = get_current_length(prefix, 'length_of_' .. obj.name)
+    local reserved_size = get_current_length(prefix, 'reserved_size_of_' .. obj.name)
 
     local res = {
-        If(Isset(prefix, obj.name)),
         CodeBlock {
-            CodeBlock {
-                'int i;\n',
-                'for(i = 0; i < ', length, '; ++i)\n',
-                '    free(', full_path, '[i]);\n'
-            },
-            'free(' .. full_path .. ");\n"
-        }
+            'size_t i;\n',
+            'for(i = 0; i < ', reserved_size, '; ++i)\n',
+            '    free(', full_path, '[i]);\n'
+        },
+        Free(full_path),
+        Free(get_current_value(prefix, 'string_sizes_of_' .. obj.name))
     }
 
     return table.concat(res)
 end
 
-local function gen_cleanup_dynamic_array(prefix, obj)
+-- Buffers are released whether or not the member is set, because reset
+-- objects keep them around for the next unpack.
+local function gen_cleanup_object_array(prefix, obj)
+    local full_path = get_current_value(prefix, obj.name)
+    local reserved_size = get_current_length(prefix, 'reserved_size_of_' .. obj.name)
+
     local res = {
-        If(Isset(prefix, obj.name)),
-        indent('free(' .. get_current_value(prefix, obj.name) .. ");\n")
+        CodeBlock {
+            'size_t i;\n',
+            'for(i = 0; i < ', reserved_size, '; ++i)\n',
+            '    ', current_element_name(prefix, obj.name), '_cleanup(&', full_path, '[i]);\n'
+        },
+        Free(full_path)
     }
 
     return table.concat(res)
 end
 
-local function gen_cleanup(obj, prefix)
+local function gen_cleanup_columns(prefix, obj)
+    local columns = get_current_value(prefix, obj.name)
+    local res = { }
+
+    local column = obj.children
+    while column do
+        res[#res+1] = Free(columns .. '.' .. column.name)
+        res[#res+1] = Free(columns .. '.is_set_' .. column.name)
+        column = column.next
+    end
+
+    return table.concat(res)
+end
+
+function gen_cleanup(obj, prefix)
     local res = { }
 
     while obj do
         match(obj.type) {
             object = function()
-                res[#res+1] = If(Isset(prefix, obj.name)) ..
-                    CodeBlock {
-                        gen_cleanup(obj.children, get_new_prefix(prefix, obj.name))
-                    }
+                if(obj.is_columnar) then
+                    res[#res+1] = gen_cleanup_columns(prefix, obj)
+                elseif(obj.length == -1) then
+                    res[#res+1] = gen_cleanup_object_array(prefix, obj)
+                else
+                    res[#res+1] = gen_cleanup(obj.children, get_new_prefix(prefix, obj.name))
+                end
             end,
             string = function()
                 if(obj.length == -1) then
                     res[#res+1] = gen_cleanup_dynamic_string_array(prefix, obj)
-                else
-                    res[#res+1] = If(Isset(prefix, obj.name)) ..
-                        indent("free(" .. get_current_value(prefix, obj.name) .. ");\n")
+                elseif(not obj.is_interned and obj.max_length == 0) then
+                    res[#res+1] = Free(get_current_value(prefix, obj.name))
                 end
             end,
             any = function()
-                res[#res+1] = If(And(Isset(prefix, obj.name),
-                                     Eq(get_current_value(prefix, obj.name) .. ".type",
-                                        'JSON_OBJ_STRING'))) ..
-                    indent("free(" .. get_current_value(prefix, obj.name) .. ".string_);\n")
+                res[#res+1] = Free(get_current_value(prefix, obj.name) .. ".string_") ..
+                    'json_tape_cleanup(&' .. get_current_value(prefix, obj.name) .. '.tape);\n'
             end,
             _ = function()
-                if(obj.length == -1) then
-                    res[#res+1] = gen_cleanup_dynamic_array(prefix, obj)
+                if(obj.length == -1 and not obj.is_stream) then
+                    res[#res+1] = Free(get_current_value(prefix, obj.name))
+                end
+                if(obj.dimensions == 2) then
+                    res[#res+1] = Free(get_current_value(prefix, 'offsets_of_' .. obj.name))
                 end
             end
         } ()
@@ -824,63 +1745,339 @@ local function gen_cleanup(obj, prefix)
     return table.concat(res)
 end
 
+function gen_reset(obj, prefix)
+    local res = { }
+
+    while obj do
+        local value = get_current_value(prefix, obj.name)
+
+        if obj.type == 'object' and obj.length == 1 then
+            res[#res+1] = gen_reset(obj.children, get_new_prefix(prefix, obj.name))
+        elseif obj.type == 'any' then
+            res[#res+1] = Assign(value .. '.type', 'JSON_OBJ_NULL') ..
+                'json_tape_reset(&' .. value .. '.tape);\n'
+        elseif obj.is_stream then
+            res[#res+1] = Assign(value .. '.length', '0') ..
+                          Assign(value .. '.batch_length', '0')
+        elseif obj.is_columnar then
+            res[#res+1] = Assign(value .. '.length', '0')
+        elseif obj.length == -1 then
+            res[#res+1] = Assign(get_current_length(prefix, 'length_of_' .. obj.name), '0')
+            if obj.dimensions == 2 then
+                res[#res+1] = Assign(get_current_length(prefix, 'rows_of_' .. obj.name), '0')
+            end
+        end
+
+        res[#res+1] = Assign(Isset(prefix, obj.name), '0')
+
+        obj = obj.next
+    end
+
+    return table.concat(res)
+end
+
+local function gen_save_stream_handlers(obj, prefix)
+    local res = { }
+
+    while obj do
+        if obj.type == 'object' and obj.length == 1 then
+            res[#res+1] = gen_save_stream_handlers(obj.children, get_new_prefix(prefix, obj.name))
+        elseif obj.is_stream then
+            local value = get_current_value(prefix, obj.name)
+            local local_name = string.gsub(get_new_prefix(prefix, obj.name), '%.', '__')
+            res[#res+1] = '__typeof__(' .. value .. '.fn) ' .. local_name .. '_fn = ' .. value .. '.fn;\n' ..
+                          'void* ' .. local_name .. '_ctx = ' .. value .. '.ctx;\n'
+        end
+
+        obj = obj.next
+    end
+
+    return table.concat(res)
+end
+
+local function gen_restore_stream_handlers(obj, prefix)
+    local res = { }
+
+    while obj do
+        if obj.type == 'object' and obj.length == 1 then
+            res[#res+1] = gen_restore_stream_handlers(obj.children, get_new_prefix(prefix, obj.name))
+        elseif obj.is_stream then
+            local value = get_current_value(prefix, obj.name)
+            local local_name = string.gsub(get_new_prefix(prefix, obj.name), '%.', '__')
+            res[#res+1] = Assign(value .. '.fn', local_name .. '_fn') ..
+                          Assign(value .. '.ctx', local_name .. '_ctx')
+        end
+
+        obj = obj.next
+    end
+
+    return table.concat(res)
+end
+
+local function has_interned(obj)
+    while obj do
+        if obj.is_interned or has_interned(obj.children) then
+            return true
+        end
+        obj = obj.next
+    end
+    return false
+end
+
+-- Clears the object for unpacking, keeping user supplied stream handlers and
+-- the intern table.
+local function gen_clear(obj)
+    local save_intern_table, restore_intern_table = '', ''
+    if has_interned(obj) then
+        save_intern_table = 'struct json_intern* intern_table = obj->intern_table;\n'
+        restore_intern_table = Assign('obj->intern_table', 'intern_table')
+    end
+
+    return 'static void ' .. JSON_NAME .. '_clear(struct ' .. JSON_NAME .. '* obj)\n' ..
+    CodeBlock {
+        gen_save_stream_handlers(obj),
+        save_intern_table,
+        'memset(obj, 0, sizeof(*obj));\n',
+        gen_restore_stream_handlers(obj),
+        restore_intern_table
+    } .. '\n'
+end
+
+-- Generated with --validate-utf8
+local function gen_validate_utf8()
+    if JSON_VALIDATE_UTF8 then
+        return '\n' .. indent(Assign('lexer->validate_utf8', '1'))
+    end
+    return ''
+end
+
+local function gen_use_intern_table(obj)
+    if not has_interned(obj) then
+        return ''
+    end
+    return '\n' .. indent(Assign('lexer->intern', 'obj->intern_table'))
+end
+
 local output = {
 [[#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <float.h>
 #include "jslex.h"
+#include "json_buffer.h"
 
 ]],
 '#include "', JSON_NAME, '.h"', [[
 
 
 ]], gen_unpack_functions(JSON_ROOT),
+gen_clear(JSON_ROOT),
 "void ", JSON_NAME, "_cleanup(struct ", JSON_NAME, "* obj)\n",
     CodeBlock {
-        gen_cleanup(JSON_ROOT)
+        gen_cleanup(JSON_ROOT),
+        Free('obj->lexer_buffer'),
+        JSON_NAME, "_clear(obj);\n"
     },
 "\n",
-"ssize_t ", JSON_NAME, "_unpack(struct ", JSON_NAME, [[* obj, const char* data)
-{
-    memset(obj, 0, sizeof(*obj));
-
-    struct jslex lexer;
-    if(jslex_init(&lexer, data) < 0)
-        return -1;
+"void ", JSON_NAME, "_reset(struct ", JSON_NAME, "* obj)\n",
+    CodeBlock {
+        gen_reset(JSON_ROOT)
+    },
+"\n",
+"static ssize_t ", JSON_NAME, "_parse(struct ", JSON_NAME, [[* obj, struct jslex* lexer)
+{]], gen_use_intern_table(JSON_ROOT), gen_validate_utf8(), [[
 
-    if(!]], JSON_NAME, [[_value(obj, &lexer))
+    if(!]], JSON_NAME, [[_value(obj, lexer))
         goto failure;
 
 ]], indent(gen_validate(JSON_ROOT)), [[
 
-    jslex_cleanup(&lexer);
-    return lexer.next_pos - data;
+    return lexer->next_pos - lexer->input;
 
 failure:
-    ]], JSON_NAME, [[_cleanup(obj);
-    jslex_cleanup(&lexer);
     return -1;
 }
 
-char* ]], JSON_NAME, [[_pack(const struct ]], JSON_NAME, [[* obj)
+ssize_t ]], JSON_NAME, "_unpack(struct ", JSON_NAME, [[* obj, const char* data)
+{
+    struct jslex lexer;
+
+    ]], JSON_NAME, [[_clear(obj);
+    if(jslex_init(&lexer, data) < 0)
+        return -1;
+
+    ssize_t r = ]], JSON_NAME, [[_parse(obj, &lexer);
+    jslex_cleanup(&lexer);
+    if(r < 0)
+        ]], JSON_NAME, [[_cleanup(obj);
+
+    return r;
+}
+
+ssize_t ]], JSON_NAME, "_unpack_reuse(struct ", JSON_NAME, [[* obj, const char* data)
+{
+    struct jslex lexer;
+
+    ]], JSON_NAME, [[_reset(obj);
+    if(jslex_init_reuse(&lexer, data, &obj->lexer_buffer, &obj->lexer_buffer_size) < 0)
+        return -1;
+
+    ssize_t r = ]], JSON_NAME, [[_parse(obj, &lexer);
+    if(r < 0)
+        ]], JSON_NAME, [[_reset(obj);
+
+    return r;
+}
+
+]], gen_size_hint_function(JSON_ROOT, 'size_t ' .. JSON_NAME .. '_packed_size_hint(const struct ' .. JSON_NAME .. '* obj)'),
+"static int ", JSON_NAME, "_pack_object(const struct ", JSON_NAME, [[* obj, struct json_buffer* out)
 {
-    size_t size = 4096;
-    char* buffer = malloc(size);
-    if(!buffer)
-        return NULL;
-    int comma = 0;
-    int i = 0;
-    char* str;
 ]], indent(Append('{') ..
     gen_pack(JSON_ROOT) ..
     Append('}')), [[
-    return buffer;
+    return 0;
 
 failure:
-    if(str)
-        free(str);
-    free(buffer);
-    return NULL;
+    return -1;
+}
+
+char* ]], JSON_NAME, [[_pack(const struct ]], JSON_NAME, [[* obj)
+{
+    struct json_buffer out;
+    if(json_buffer_init(&out, ]], JSON_NAME, [[_packed_size_hint(obj)) < 0)
+        return NULL;
+
+    if(]], JSON_NAME, [[_pack_object(obj, &out) < 0)
+    {
+        json_buffer_cleanup(&out);
+        return NULL;
+    }
+
+    return json_buffer_release(&out);
+}
+
+ssize_t ]], JSON_NAME, [[_pack_into(const struct ]], JSON_NAME, [[* obj, char* buffer, size_t size)
+{
+    struct json_buffer out;
+    json_buffer_init_fixed(&out, buffer, size);
+
+    if(]], JSON_NAME, [[_pack_object(obj, &out) < 0)
+        return -1;
+
+    return out.length;
+}
+
+ssize_t ]], JSON_NAME, [[_packed_size(const struct ]], JSON_NAME, [[* obj)
+{
+    return ]], JSON_NAME, [[_pack_into(obj, NULL, 0);
+}
+
+ssize_t ]], JSON_NAME, [[_pack_stream(const struct ]], JSON_NAME, [[* obj,
+        int (*write)(void* ctx, const struct iovec* iov, int count), void* ctx)
+{
+    struct json_buffer out;
+    if(json_buffer_init_stream(&out, JSON_BUFFER_STREAM_SIZE, write, ctx) < 0)
+        return -1;
+
+    ssize_t r = -1;
+    if(]], JSON_NAME, [[_pack_object(obj, &out) == 0 && json_buffer_flush(&out) == 0)
+        r = out.flushed;
+
+    json_buffer_cleanup(&out);
+    return r;
+}
+
+ssize_t ]], JSON_NAME, [[_pack_fd(const struct ]], JSON_NAME, [[* obj, int fd)
+{
+    return ]], JSON_NAME, [[_pack_stream(obj, json_buffer_write_fd, &fd);
+}
+
+/* Records are packed one after another into the same buffer, each followed
+ * by a newline. Any values are written without whitespace, so that each
+ * record stays on a line of its own.
+ */
+static int ]], JSON_NAME, [[_pack_record(const void* item, struct json_buffer* out)
+{
+    out->is_compact = 1;
+
+    if(]], JSON_NAME, [[_pack_object(item, out) < 0)
+        return -1;
+
+    return json_buffer_append_literal(out, "\n", 1);
+}
+
+static int ]], JSON_NAME, [[_pack_records(const struct ]], JSON_NAME, [[* items, size_t n, struct json_buffer* out)
+{
+    size_t i;
+    for(i = 0; i < n; ++i)
+        if(]], JSON_NAME, [[_pack_record(&items[i], out) < 0)
+            return -1;
+
+    return 0;
+}
+
+/* The first record gives an estimate for the size of the others, but the
+ * buffer starts out no larger than JSON_BUFFER_MANY_SIZE */
+char* ]], JSON_NAME, [[_pack_many(const struct ]], JSON_NAME, [[* items, size_t n)
+{
+    size_t size = 0;
+    if(n > 0)
+    {
+        size_t hint = ]], JSON_NAME, [[_packed_size_hint(&items[0]) + 1;
+        size = hint <= JSON_BUFFER_MANY_SIZE / n ? hint * n : JSON_BUFFER_MANY_SIZE;
+    }
+
+    struct json_buffer out;
+    if(json_buffer_init(&out, size) < 0)
+        return NULL;
+
+    if(]], JSON_NAME, [[_pack_records(items, n, &out) < 0)
+    {
+        json_buffer_cleanup(&out);
+        return NULL;
+    }
+
+    return json_buffer_release(&out);
+}
+
+ssize_t ]], JSON_NAME, [[_pack_many_stream(const struct ]], JSON_NAME, [[* items, size_t n,
+        int (*write)(void* ctx, const struct iovec* iov, int count), void* ctx)
+{
+    struct json_buffer out;
+    if(json_buffer_init_stream(&out, JSON_BUFFER_STREAM_SIZE, write, ctx) < 0)
+        return -1;
+
+    ssize_t r = -1;
+    if(]], JSON_NAME, [[_pack_records(items, n, &out) == 0 && json_buffer_flush(&out) == 0)
+        r = out.flushed;
+
+    json_buffer_cleanup(&out);
+    return r;
+}
+
+ssize_t ]], JSON_NAME, [[_pack_many_fd(const struct ]], JSON_NAME, [[* items, size_t n, int fd)
+{
+    return ]], JSON_NAME, [[_pack_many_stream(items, n, json_buffer_write_fd, &fd);
+}
+
+int ]], JSON_NAME, [[_pack_many_parallel(struct json_pool* pool, const struct ]], JSON_NAME, [[* items, size_t n,
+        struct json_batch* batch)
+{
+    return json_pool_pack(pool, items, n, sizeof(*items), ]], JSON_NAME, [[_pack_record, batch);
+}
+
+ssize_t ]], JSON_NAME, [[_pack_many_parallel_fd(struct json_pool* pool, const struct ]], JSON_NAME, [[* items, size_t n,
+        int fd)
+{
+    struct json_batch batch;
+    ssize_t r = -1;
+
+    if(]], JSON_NAME, [[_pack_many_parallel(pool, items, n, &batch) == 0
+       && (batch.count == 0 || json_buffer_write_fd(&fd, batch.iov, batch.count) == 0))
+        r = batch.length;
+
+    json_batch_cleanup(&batch);
+    return r;
 }
 ]]
 }
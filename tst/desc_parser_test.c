@@ -0,0 +1,172 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "tst.h"
+#include "obj.h"
+#include "desc_parser.h"
+
+static const char* schema_ =
+    "id: int.\n"
+    "name: string(8)?\n"
+    "point: { x: real. y: real. }?\n"
+    "kind: enum(small, large)?\n";
+
+static char report_[1024];
+
+static const char* report(const struct desc_parser* parser)
+{
+    FILE* stream = fmemopen(report_, sizeof(report_), "w");
+    if(!stream)
+        return "";
+
+    desc_print_error_report(parser, stream);
+    fclose(stream);
+    return report_;
+}
+
+static int test_parse()
+{
+    struct desc_parser parser;
+    struct obj* root = desc_parse(&parser, schema_);
+    ASSERT_TRUE(root);
+
+    struct obj* obj = root;
+    ASSERT_STR_EQ("id", (const char*)obj->name);
+    ASSERT_INT_EQ(OBJ_INTEGER, obj->type);
+    ASSERT_FALSE(obj->is_optional);
+
+    obj = obj->next;
+    ASSERT_STR_EQ("name", (const char*)obj->name);
+    ASSERT_INT_EQ(8, obj->max_length);
+    ASSERT_TRUE(obj->is_optional);
+
+    obj = obj->next;
+    ASSERT_INT_EQ(OBJ_OBJECT, obj->type);
+    ASSERT_STR_EQ("y", (const char*)obj->children->next->name);
+
+    obj = obj->next;
+    ASSERT_INT_EQ(OBJ_ENUM, obj->type);
+    ASSERT_STR_EQ("large", (const char*)obj->children->next->name);
+    ASSERT_FALSE(obj->next);
+
+    obj_free(root);
+    return 0;
+}
+
+static int test_errors()
+{
+    struct desc_parser parser;
+
+    ASSERT_FALSE(desc_parse(&parser, "id int."));
+    ASSERT_INT_EQ(DESC_E_UNEXPECTED_TOKEN, parser.error);
+    ASSERT_TRUE(strstr(report(&parser), "Expected: ':'"));
+    ASSERT_TRUE(strstr(report(&parser), "Line 1:"));
+
+    ASSERT_FALSE(desc_parse(&parser, "id: int.\nnames: string[][]."));
+    ASSERT_INT_EQ(DESC_E_INVALID_NESTED_ARRAY, parser.error);
+    ASSERT_TRUE(strstr(report(&parser), "Line 2:"));
+
+    ASSERT_FALSE(desc_parse(&parser, "kind: enum(a, a)."));
+    ASSERT_INT_EQ(DESC_E_INVALID_ENUM, parser.error);
+
+    ASSERT_FALSE(desc_parse(&parser, "status: enum(ok, OK)."));
+    ASSERT_INT_EQ(DESC_E_INVALID_ENUM, parser.error);
+
+    ASSERT_FALSE(desc_parse(&parser, "name: string(256)."));
+    ASSERT_INT_EQ(DESC_E_INVALID_INLINE_STRING, parser.error);
+
+    ASSERT_FALSE(desc_parse(&parser, "id: int columnar."));
+    ASSERT_INT_EQ(DESC_E_INVALID_ATTRIBUTE, parser.error);
+
+    ASSERT_FALSE(desc_parse(&parser, "xs: int[] stream(0)."));
+    ASSERT_INT_EQ(DESC_E_INVALID_ATTRIBUTE, parser.error);
+
+    ASSERT_FALSE(desc_parse(&parser, "xs: int[] stream(1000000000000000)."));
+    ASSERT_INT_EQ(DESC_E_INVALID_ATTRIBUTE, parser.error);
+
+    struct obj* obj = desc_parse(&parser, "xs: int[] stream(4096).");
+    ASSERT_TRUE(obj);
+    ASSERT_INT_EQ(4096, obj->batch_size);
+    obj_free(obj);
+    return 0;
+}
+
+static int test_separate_contexts()
+{
+    struct desc_parser failed, succeeded;
+
+    ASSERT_FALSE(desc_parse(&failed, "id: int.\nname string."));
+    char expected[sizeof(report_)];
+    strcpy(expected, report(&failed));
+
+    struct obj* obj = desc_parse(&succeeded, schema_);
+    ASSERT_TRUE(obj);
+    obj_free(obj);
+
+    ASSERT_INT_EQ(DESC_E_UNEXPECTED_TOKEN, failed.error);
+    ASSERT_STR_EQ((const char*)expected, report(&failed));
+    return 0;
+}
+
+struct worker {
+    pthread_t thread;
+    const char* input;
+    int is_valid;
+    int failures;
+};
+
+static void* parse_many(void* arg)
+{
+    struct worker* worker = arg;
+    struct desc_parser parser;
+
+    int i;
+    for(i = 0; i < 1000; ++i)
+    {
+        struct obj* obj = desc_parse(&parser, worker->input);
+        if(!obj != !worker->is_valid)
+            ++worker->failures;
+        if(!obj && parser.error != DESC_E_UNEXPECTED_TOKEN)
+            ++worker->failures;
+        if(obj)
+            obj_free(obj);
+    }
+
+    return NULL;
+}
+
+static int test_threads()
+{
+    struct worker workers[4];
+
+    int i;
+    for(i = 0; i < 4; ++i)
+    {
+        workers[i].is_valid = i % 2 == 0;
+        workers[i].input = workers[i].is_valid ? schema_ : "id: int.\nx y.";
+        workers[i].failures = 0;
+        ASSERT_INT_EQ(0, pthread_create(&workers[i].thread, NULL, parse_many,
+                                        &workers[i]));
+    }
+
+    for(i = 0; i < 4; ++i)
+    {
+        ASSERT_INT_EQ(0, pthread_join(workers[i].thread, NULL));
+        ASSERT_INT_EQ(0, workers[i].failures);
+    }
+
+    return 0;
+}
+
+int main(int argc, char* argv[])
+{
+    int r = 0;
+
+    RUN_TEST(test_parse);
+    RUN_TEST(test_errors);
+    RUN_TEST(test_separate_contexts);
+    RUN_TEST(test_threads);
+
+    return r;
+}
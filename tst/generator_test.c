@@ -1,7 +1,9 @@
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include "tst.h"
 #include "test.h"
+#include "json_intern.h"
 
 static int test_integer()
 {
@@ -42,6 +44,38 @@ static int test_real()
     return 0;
 }
 
+static int test_real_roundtrip()
+{
+    struct test in, out;
+    memset(&in, 0, sizeof(in));
+    in.is_set_the_real = 1;
+    in.the_real = 1.0 / 3.0;
+    in.is_set_the_float = 1;
+    in.the_float = 0.1f;
+
+    char* json = test_pack(&in);
+    ASSERT_TRUE(json);
+    ASSERT_TRUE(strstr(json, "\"the_real\":0.3333333333333333,"));
+    ASSERT_TRUE(strstr(json, "\"the_float\":0.1}"));
+
+    ASSERT_INT_GE(0, test_unpack(&out, json));
+    ASSERT_TRUE(out.the_real == in.the_real);
+    ASSERT_TRUE(out.the_float == in.the_float);
+    free(json);
+
+    in.the_real = 5e-324;
+    json = test_pack(&in);
+    ASSERT_TRUE(json);
+    ASSERT_TRUE(strstr(json, "\"the_real\":5e-324,"));
+
+    ASSERT_INT_GE(0, test_unpack_reuse(&out, json));
+    ASSERT_TRUE(out.the_real == in.the_real);
+
+    test_cleanup(&out);
+    free(json);
+    return 0;
+}
+
 static int test_bool()
 {
     struct test in, out;
@@ -93,6 +127,12 @@ static int test_object()
     ASSERT_INT_GE(0, test_unpack(&out, json));
     ASSERT_TRUE(out.is_set_the_object);
     ASSERT_INT_EQ(42, out.the_object.the_member);
+    test_cleanup(&out);
+
+    /* Later keys are tried against the object member too */
+    ASSERT_INT_GE(0, test_unpack(&out, "{\"the_object\":{\"the_member\":1},\"the_label\":\"x\"}"));
+    ASSERT_TRUE(out.is_set_the_object);
+    ASSERT_TRUE(out.is_set_the_label);
 
     test_cleanup(&out);
     free(json);
@@ -120,6 +160,46 @@ static int test_any()
     return 0;
 }
 
+static int test_any_object()
+{
+    struct test out;
+    const char* json = "{\"the_any\": {\"a\": [1, {\"b\": \"c\"}], \"d\": null}}";
+
+    ASSERT_INT_GE(0, test_unpack(&out, json));
+    ASSERT_TRUE(out.is_set_the_any);
+    ASSERT_INT_EQ(JSON_OBJ_OBJECT, out.the_any.type);
+
+    const struct json_tape* tape = &out.the_any.tape;
+    const struct json_tape_node* a = json_tape_member(tape, json_tape_root(tape), "a");
+    ASSERT_TRUE(a);
+    ASSERT_INT_EQ(2, a->length);
+    const struct json_tape_node* b = json_tape_member(tape, json_tape_child(tape, a, 1), "b");
+    ASSERT_TRUE(b);
+    ASSERT_STR_EQ("c", json_tape_string(tape, b));
+
+    char* packed = test_pack(&out);
+    ASSERT_TRUE(packed);
+    ASSERT_TRUE(strstr(packed, "\"the_any\":{\"a\": [1, {\"b\": \"c\"}], \"d\": null}"));
+
+    ASSERT_INT_GE(0, test_unpack_reuse(&out, "{\"the_any\": [true, null]}"));
+    ASSERT_INT_EQ(JSON_OBJ_ARRAY, out.the_any.type);
+    ASSERT_INT_EQ(3, out.the_any.tape.length);
+
+    ASSERT_INT_GE(0, test_unpack_reuse(&out, "{\"the_any\": null}"));
+    ASSERT_INT_EQ(JSON_OBJ_NULL, out.the_any.type);
+
+    ASSERT_INT_GE(0, test_unpack_reuse(&out, "{\"the_any\": false}"));
+    ASSERT_INT_EQ(JSON_OBJ_BOOL, out.the_any.type);
+    ASSERT_FALSE(out.the_any.boolean);
+
+    ASSERT_INT_LT(0, test_unpack_reuse(&out, "{\"the_any\": nope}"));
+    ASSERT_INT_LT(0, test_unpack_reuse(&out, "{\"the_any\": True}"));
+
+    test_cleanup(&out);
+    free(packed);
+    return 0;
+}
+
 static int test_array()
 {
     struct test in, out;
@@ -144,16 +224,695 @@ static int test_array()
     return 0;
 }
 
+static int test_large_array()
+{
+    struct test in, out;
+    memset(&in, 0, sizeof(in));
+    in.is_set_the_array = 1;
+    in.length_of_the_array = 100000;
+    in.the_array = malloc(in.length_of_the_array * sizeof(*in.the_array));
+    ASSERT_TRUE(in.the_array);
+
+    size_t i;
+    for(i = 0; i < in.length_of_the_array; ++i)
+        in.the_array[i] = i * 1000003;
+
+    char* json = test_pack(&in);
+    ASSERT_TRUE(json);
+    ASSERT_TRUE(strlen(json) <= test_packed_size_hint(&in));
+
+    ASSERT_INT_GE(0, test_unpack(&out, json));
+    ASSERT_INT_EQ(100000, out.length_of_the_array);
+    ASSERT_TRUE(out.the_array[99999] == 99999LL * 1000003);
+
+    test_cleanup(&out);
+    free(in.the_array);
+    free(json);
+    return 0;
+}
+
+static int test_caller_buffer()
+{
+    struct test in;
+    memset(&in, 0, sizeof(in));
+    in.is_set_the_integer = 1;
+    in.the_integer = 42;
+    in.is_set_the_string = 1;
+    in.the_string = "some \"text\"";
+
+    char* json = test_pack(&in);
+    ASSERT_TRUE(json);
+    size_t length = strlen(json);
+    ASSERT_INT_EQ(length, test_packed_size(&in));
+
+    char buffer[256];
+    memset(buffer, 'x', sizeof(buffer));
+    ASSERT_INT_EQ(length, test_pack_into(&in, buffer, length + 1));
+    ASSERT_STR_EQ(json, (const char*)buffer);
+    ASSERT_INT_EQ('x', buffer[length + 1]);
+
+    /* Output that does not fit is only counted */
+    memset(buffer, 'x', sizeof(buffer));
+    ASSERT_INT_EQ(length, test_pack_into(&in, buffer, 10));
+    ASSERT_INT_EQ('x', buffer[10]);
+    ASSERT_INT_EQ(length, test_pack_into(&in, buffer, length));
+
+    free(json);
+    return 0;
+}
+
+struct chunks {
+    char* data;
+    size_t length;
+    int writes;
+};
+
+static int collect_chunks(void* ctx, const struct iovec* iov, int count)
+{
+    struct chunks* chunks = ctx;
+    int i;
+
+    for(i = 0; i < count; ++i)
+    {
+        char* data = realloc(chunks->data, chunks->length + iov[i].iov_len + 1);
+        if(!data)
+            return -1;
+
+        memcpy(&data[chunks->length], iov[i].iov_base, iov[i].iov_len);
+        chunks->data = data;
+        chunks->length += iov[i].iov_len;
+        chunks->data[chunks->length] = '\0';
+    }
+
+    chunks->writes++;
+    return 0;
+}
+
+static int test_stream_pack()
+{
+    struct test in;
+    memset(&in, 0, sizeof(in));
+    in.is_set_the_array = 1;
+    in.length_of_the_array = 50000;
+    in.the_array = malloc(in.length_of_the_array * sizeof(*in.the_array));
+    ASSERT_TRUE(in.the_array);
+
+    size_t i;
+    for(i = 0; i < in.length_of_the_array; ++i)
+        in.the_array[i] = i;
+
+    char* json = test_pack(&in);
+    ASSERT_TRUE(json);
+
+    struct chunks chunks;
+    memset(&chunks, 0, sizeof(chunks));
+    ASSERT_INT_EQ(strlen(json), test_pack_stream(&in, collect_chunks, &chunks));
+    ASSERT_TRUE(chunks.writes > 1);
+    ASSERT_STR_EQ(json, (const char*)chunks.data);
+
+    FILE* file = tmpfile();
+    ASSERT_TRUE(file);
+    ASSERT_INT_EQ(strlen(json), test_pack_fd(&in, fileno(file)));
+
+    rewind(file);
+    memset(chunks.data, 0, chunks.length);
+    ASSERT_INT_EQ(strlen(json), fread(chunks.data, 1, chunks.length, file));
+    ASSERT_STR_EQ(json, (const char*)chunks.data);
+
+    fclose(file);
+    free(chunks.data);
+    free(in.the_array);
+    free(json);
+    return 0;
+}
+
+static int test_many_records()
+{
+    struct test in[3];
+    memset(in, 0, sizeof(in));
+    in[0].is_set_the_integer = 1;
+    in[0].the_integer = 1;
+    in[2].is_set_the_string = 1;
+    in[2].the_string = "three";
+
+    char* json = test_pack_many(in, 3);
+    ASSERT_TRUE(json);
+    ASSERT_STR_EQ("{\"the_integer\":1}\n{}\n{\"the_string\":\"three\"}\n", json);
+
+    struct chunks chunks;
+    memset(&chunks, 0, sizeof(chunks));
+    ASSERT_INT_EQ(strlen(json), test_pack_many_stream(in, 3, collect_chunks, &chunks));
+    ASSERT_STR_EQ(json, (const char*)chunks.data);
+
+    char* empty = test_pack_many(in, 0);
+    ASSERT_TRUE(empty);
+    ASSERT_STR_EQ("", empty);
+
+    /* More than JSON_BUFFER_MANY_SIZE, so the buffer has to grow */
+    size_t length = JSON_BUFFER_MANY_SIZE / 2;
+    char* string = malloc(length + 1);
+    ASSERT_TRUE(string);
+    memset(string, 'x', length);
+    string[length] = '\0';
+    struct test big[4];
+    memset(big, 0, sizeof(big));
+    size_t i;
+    for(i = 0; i < 4; ++i)
+    {
+        big[i].is_set_the_string = 1;
+        big[i].the_string = string;
+    }
+
+    char* big_json = test_pack_many(big, 4);
+    ASSERT_TRUE(big_json);
+    ASSERT_INT_EQ(4 * (length + strlen("{\"the_string\":\"\"}\n")), strlen(big_json));
+
+    free(big_json);
+    free(string);
+    free(empty);
+    free(chunks.data);
+    free(json);
+    return 0;
+}
+
+static int test_many_records_any()
+{
+    struct test in[2];
+    memset(in, 0, sizeof(in));
+    ASSERT_INT_GE(0, test_unpack(&in[0], "{\"the_any\": {\n  \"b\": [1,\n 2]\n}}"));
+    ASSERT_INT_GE(0, test_unpack(&in[1], "{\"the_any\": [\"x\\n\"\n]}"));
+
+    char* json = test_pack_many(in, 2);
+    ASSERT_TRUE(json);
+    ASSERT_STR_EQ("{\"the_any\":{\"b\":[1,2]}}\n{\"the_any\":[\"x\\n\"]}\n", json);
+
+    struct json_pool pool;
+    ASSERT_INT_EQ(0, json_pool_init(&pool, 2));
+    struct json_batch batch;
+    ASSERT_INT_EQ(0, test_pack_many_parallel(&pool, in, 2, &batch));
+    ASSERT_INT_EQ(strlen(json), batch.length);
+    ASSERT_INT_EQ(0, memcmp(json, batch.iov[0].iov_base, batch.iov[0].iov_len));
+
+    char* single = test_pack(&in[0]);
+    ASSERT_TRUE(single);
+    ASSERT_TRUE(strchr(single, '\n'));
+
+    json_batch_cleanup(&batch);
+    json_pool_cleanup(&pool);
+    test_cleanup(&in[0]);
+    test_cleanup(&in[1]);
+    free(single);
+    free(json);
+    return 0;
+}
+
+static int test_parallel_records()
+{
+    size_t n = 5000;
+    struct test* in = calloc(n, sizeof(*in));
+    ASSERT_TRUE(in);
+
+    size_t i;
+    for(i = 0; i < n; ++i)
+    {
+        in[i].is_set_the_integer = 1;
+        in[i].the_integer = i;
+    }
+
+    char* json = test_pack_many(in, n);
+    ASSERT_TRUE(json);
+
+    struct json_pool pool;
+    ASSERT_INT_EQ(0, json_pool_init(&pool, 4));
+
+    struct json_batch batch;
+    ASSERT_INT_EQ(0, test_pack_many_parallel(&pool, in, n, &batch));
+    ASSERT_TRUE(batch.count > 1);
+    ASSERT_INT_EQ(strlen(json), batch.length);
+
+    char* joined = malloc(batch.length + 1);
+    ASSERT_TRUE(joined);
+    size_t length = 0;
+    int k;
+    for(k = 0; k < batch.count; ++k)
+    {
+        memcpy(&joined[length], batch.iov[k].iov_base, batch.iov[k].iov_len);
+        length += batch.iov[k].iov_len;
+    }
+    joined[length] = '\0';
+    ASSERT_STR_EQ(json, (const char*)joined);
+
+    FILE* file = tmpfile();
+    ASSERT_TRUE(file);
+    ASSERT_INT_EQ(strlen(json), test_pack_many_parallel_fd(&pool, in, n, fileno(file)));
+    rewind(file);
+    memset(joined, 0, length);
+    ASSERT_INT_EQ(length, fread(joined, 1, length, file));
+    ASSERT_STR_EQ(json, (const char*)joined);
+
+    fclose(file);
+    json_batch_cleanup(&batch);
+    json_pool_cleanup(&pool);
+    free(joined);
+    free(json);
+    free(in);
+    return 0;
+}
+
+static int test_sized_numbers()
+{
+    struct test in, out;
+    memset(&in, 0, sizeof(in));
+    in.is_set_the_short = 1;
+    in.the_short = -1234;
+    in.is_set_the_float = 1;
+    in.the_float = 0.5f;
+    in.is_set_the_bytes = 1;
+    uint8_t bytes[] = { 0, 128, 255 };
+    in.the_bytes = bytes;
+    in.length_of_the_bytes = 3;
+    in.is_set_the_counter = 1;
+    in.the_counter = UINT64_MAX;
+
+    char* json = test_pack(&in);
+    ASSERT_TRUE(json);
+    ASSERT_TRUE(strstr(json, "\"the_counter\":18446744073709551615"));
+
+    ASSERT_INT_GE(0, test_unpack(&out, json));
+    ASSERT_INT_EQ(-1234, out.the_short);
+    ASSERT_DOUBLE_EQ(0.5, out.the_float);
+    ASSERT_INT_EQ(3, out.length_of_the_bytes);
+    ASSERT_INT_EQ(0, out.the_bytes[0]);
+    ASSERT_INT_EQ(128, out.the_bytes[1]);
+    ASSERT_INT_EQ(255, out.the_bytes[2]);
+    ASSERT_TRUE(out.the_counter == UINT64_MAX);
+    test_cleanup(&out);
+
+    ASSERT_INT_GE(0, test_unpack(&out, "{\"the_counter\":9223372036854775808}"));
+    ASSERT_TRUE(out.the_counter == 9223372036854775808ull);
+    test_cleanup(&out);
+
+    ASSERT_INT_GE(0, test_unpack(&out, "{\"the_counter\":42}"));
+    ASSERT_TRUE(out.the_counter == 42);
+    test_cleanup(&out);
+
+    free(json);
+    return 0;
+}
+
+static int test_sized_numbers_out_of_range()
+{
+    struct test out;
+    ASSERT_INT_LT(0, test_unpack(&out, "{\"the_short\":32768}"));
+    ASSERT_INT_LT(0, test_unpack(&out, "{\"the_bytes\":[1,256]}"));
+    ASSERT_INT_LT(0, test_unpack(&out, "{\"the_bytes\":[-1]}"));
+    ASSERT_INT_LT(0, test_unpack(&out, "{\"the_float\":1e39}"));
+    ASSERT_INT_LT(0, test_unpack(&out, "{\"the_counter\":-1}"));
+    ASSERT_INT_LT(0, test_unpack(&out, "{\"the_counter\":18446744073709551616}"));
+    ASSERT_INT_LT(0, test_unpack(&out, "{\"the_counter\":1.5}"));
+    ASSERT_INT_LT(0, test_unpack(&out, "{\"the_counter\":1e19}"));
+    return 0;
+}
+
+static int test_reuse()
+{
+    struct test out;
+    memset(&out, 0, sizeof(out));
+
+    ASSERT_INT_GE(0, test_unpack_reuse(&out,
+                "{\"the_string\":\"foobar\",\"the_array\":[1,2,3]}"));
+    ASSERT_STR_EQ("foobar", out.the_string);
+    ASSERT_INT_EQ(3, out.length_of_the_array);
+
+    char* string = out.the_string;
+    long long* array = out.the_array;
+
+    ASSERT_INT_GE(0, test_unpack_reuse(&out,
+                "{\"the_string\":\"barfoo\",\"the_array\":[4,5]}"));
+    ASSERT_TRUE(out.is_set_the_string);
+    ASSERT_STR_EQ("barfoo", out.the_string);
+    ASSERT_PTR_EQ(string, out.the_string);
+    ASSERT_INT_EQ(2, out.length_of_the_array);
+    ASSERT_INT_EQ(4, out.the_array[0]);
+    ASSERT_INT_EQ(5, out.the_array[1]);
+    ASSERT_PTR_EQ(array, out.the_array);
+
+    ASSERT_INT_GE(0, test_unpack_reuse(&out, "{\"the_integer\":42}"));
+    ASSERT_FALSE(out.is_set_the_string);
+    ASSERT_FALSE(out.is_set_the_array);
+    ASSERT_INT_EQ(0, out.length_of_the_array);
+    ASSERT_INT_EQ(42, out.the_integer);
+
+    ASSERT_INT_GE(0, test_unpack_reuse(&out,
+                "{\"the_items\":[{\"the_id\":1,\"the_tags\":[\"abc\",\"de\"]}],"
+                "\"the_any\":\"xyz\"}"));
+    ASSERT_INT_EQ(1, out.length_of_the_items);
+    ASSERT_INT_EQ(2, out.the_items[0].length_of_the_tags);
+    ASSERT_STR_EQ("xyz", out.the_any.string_);
+
+    struct test_the_items* items = out.the_items;
+    char** tags = out.the_items[0].the_tags;
+    char* tag = out.the_items[0].the_tags[0];
+    char* any_string = out.the_any.string_;
+    char* lexer_buffer = out.lexer_buffer;
+
+    ASSERT_INT_GE(0, test_unpack_reuse(&out,
+                "{\"the_items\":[{\"the_id\":2,\"the_tags\":[\"fg\",\"h\"]}],"
+                "\"the_any\":\"uv\"}"));
+    ASSERT_INT_EQ(2, out.the_items[0].the_id);
+    ASSERT_STR_EQ("fg", out.the_items[0].the_tags[0]);
+    ASSERT_STR_EQ("h", out.the_items[0].the_tags[1]);
+    ASSERT_STR_EQ("uv", out.the_any.string_);
+    ASSERT_PTR_EQ(items, out.the_items);
+    ASSERT_PTR_EQ(tags, out.the_items[0].the_tags);
+    ASSERT_PTR_EQ(tag, out.the_items[0].the_tags[0]);
+    ASSERT_PTR_EQ(any_string, out.the_any.string_);
+    ASSERT_PTR_EQ(lexer_buffer, out.lexer_buffer);
+
+    test_cleanup(&out);
+    return 0;
+}
+
+struct stream_sum {
+    int calls;
+    size_t count;
+    double sum;
+};
+
+static int sum_stream(void* ctx, const double* elems, size_t n)
+{
+    struct stream_sum* sum = ctx;
+    size_t i;
+
+    sum->calls++;
+    sum->count += n;
+    for(i = 0; i < n; ++i)
+        sum->sum += elems[i];
+
+    return 0;
+}
+
+static int test_stream()
+{
+    struct test out;
+    struct stream_sum sum;
+    memset(&sum, 0, sizeof(sum));
+    memset(&out, 0, sizeof(out));
+    out.the_stream.fn = sum_stream;
+    out.the_stream.ctx = &sum;
+
+    const char* json = "{\"the_stream\":[1.0,2.0,3.0,4.0,5.0,6.0,7.0,8.0,9.0,10.0]}";
+
+    ASSERT_INT_GE(0, test_unpack(&out, json));
+    ASSERT_TRUE(out.is_set_the_stream);
+    ASSERT_INT_EQ(10, out.the_stream.length);
+    ASSERT_INT_EQ(3, sum.calls);
+    ASSERT_INT_EQ(10, sum.count);
+    ASSERT_DOUBLE_GT(54.9, sum.sum);
+    ASSERT_DOUBLE_LT(55.1, sum.sum);
+    test_cleanup(&out);
+
+    /* Elements are not dropped silently when nobody takes them */
+    memset(&out, 0, sizeof(out));
+    ASSERT_INT_LT(0, test_unpack(&out, json));
+    ASSERT_INT_LT(0, test_unpack(&out, "{\"the_stream\":[]}"));
+    return 0;
+}
+
+static int test_object_array()
+{
+    struct test out;
+    const char* json = "{\"the_items\": ["
+        "{\"the_id\": 1, \"the_name\": \"one\"},"
+        "{\"the_id\": 2, \"the_tags\": [\"a\", \"b\"]}]}";
+
+    ASSERT_INT_GE(0, test_unpack(&out, json));
+    ASSERT_TRUE(out.is_set_the_items);
+    ASSERT_INT_EQ(2, out.length_of_the_items);
+    ASSERT_INT_EQ(1, out.the_items[0].the_id);
+    ASSERT_TRUE(out.the_items[0].is_set_the_name);
+    ASSERT_STR_EQ("one", out.the_items[0].the_name);
+    ASSERT_INT_EQ(2, out.the_items[1].the_id);
+    ASSERT_FALSE(out.the_items[1].is_set_the_name);
+    ASSERT_INT_EQ(2, out.the_items[1].length_of_the_tags);
+    ASSERT_STR_EQ("b", out.the_items[1].the_tags[1]);
+
+    char* packed = test_pack(&out);
+    ASSERT_TRUE(packed);
+
+    ASSERT_INT_GE(0, test_unpack_reuse(&out, packed));
+    ASSERT_INT_EQ(2, out.length_of_the_items);
+    ASSERT_STR_EQ("one", out.the_items[0].the_name);
+    ASSERT_STR_EQ("a", out.the_items[1].the_tags[0]);
+
+    ASSERT_INT_LT(0, test_unpack_reuse(&out, "{\"the_items\": [{\"the_name\": \"x\"}]}"));
+
+    test_cleanup(&out);
+    free(packed);
+    return 0;
+}
+
+static int test_object_array_names()
+{
+    struct test out;
+    const char* json = "{\"the_pair\":{\"the_list\":[{\"the_x\":1}]},"
+        "\"the_pair_the_list\":[{\"the_y\":2},{\"the_y\":3}]}";
+
+    ASSERT_INT_GE(0, test_unpack(&out, json));
+
+    struct test_the_pair__the_list* nested = out.the_pair.the_list;
+    struct test_the_pair_the_list* flat = out.the_pair_the_list;
+    ASSERT_INT_EQ(1, out.the_pair.length_of_the_list);
+    ASSERT_INT_EQ(1, nested[0].the_x);
+    ASSERT_INT_EQ(2, out.length_of_the_pair_the_list);
+    ASSERT_INT_EQ(3, flat[1].the_y);
+
+    char* packed = test_pack(&out);
+    ASSERT_STR_EQ(json, packed);
+
+    test_cleanup(&out);
+    free(packed);
+    return 0;
+}
+
+static int test_pack_keys()
+{
+    struct test out;
+    const char* json = "{\"the_object\":{\"the_member\":1},"
+        "\"the_items\":[{\"the_id\":1},{\"the_id\":2,\"the_kind\":\"large\"}],"
+        "\"the_samples\":[{\"the_time\":10,\"the_valid\":false},{\"the_time\":20}],"
+        "\"the_status\":\"ok\"}";
+
+    ASSERT_INT_GE(0, test_unpack(&out, json));
+
+    char* packed = test_pack(&out);
+    ASSERT_TRUE(packed);
+    ASSERT_STR_EQ(json, packed);
+
+    test_cleanup(&out);
+    free(packed);
+    return 0;
+}
+
+static int column_is_set(const unsigned char* bitmap, size_t row)
+{
+    return JSON_COLUMN_IS_SET(bitmap, row);
+}
+
+static int test_columnar()
+{
+    struct test out;
+    const char* json = "{\"the_samples\": ["
+        "{\"the_time\": 10, \"the_value\": 1.5},"
+        "{\"the_time\": 20, \"the_valid\": true},"
+        "{\"the_time\": 30, \"the_value\": 2.5}]}";
+
+    ASSERT_INT_GE(0, test_unpack(&out, json));
+    ASSERT_TRUE(out.is_set_the_samples);
+    ASSERT_INT_EQ(3, out.the_samples.length);
+    ASSERT_INT_EQ(20, out.the_samples.the_time[1]);
+    ASSERT_TRUE(column_is_set(out.the_samples.is_set_the_value, 0));
+    ASSERT_FALSE(column_is_set(out.the_samples.is_set_the_value, 1));
+    ASSERT_TRUE(column_is_set(out.the_samples.is_set_the_valid, 1));
+    ASSERT_TRUE(out.the_samples.the_valid[1]);
+    ASSERT_DOUBLE_EQ(2.5, out.the_samples.the_value[2]);
+
+    char* packed = test_pack(&out);
+    ASSERT_TRUE(packed);
+
+    ASSERT_INT_GE(0, test_unpack_reuse(&out, packed));
+    ASSERT_INT_EQ(3, out.the_samples.length);
+    ASSERT_INT_EQ(30, out.the_samples.the_time[2]);
+    ASSERT_FALSE(column_is_set(out.the_samples.is_set_the_valid, 2));
+
+    ASSERT_INT_LT(0, test_unpack_reuse(&out, "{\"the_samples\": [{\"the_value\": 1.0}]}"));
+
+    test_cleanup(&out);
+    free(packed);
+    return 0;
+}
+
+static int test_nested_array()
+{
+    struct test out;
+    const char* json = "{\"the_matrix\": [[1.0, 2.0], [], [3.0]]}";
+
+    ASSERT_INT_GE(0, test_unpack(&out, json));
+    ASSERT_TRUE(out.is_set_the_matrix);
+    ASSERT_INT_EQ(3, out.rows_of_the_matrix);
+    ASSERT_INT_EQ(3, out.length_of_the_matrix);
+    ASSERT_INT_EQ(0, out.offsets_of_the_matrix[0]);
+    ASSERT_INT_EQ(2, out.offsets_of_the_matrix[1]);
+    ASSERT_INT_EQ(2, out.offsets_of_the_matrix[2]);
+    ASSERT_INT_EQ(3, out.offsets_of_the_matrix[3]);
+    ASSERT_DOUBLE_EQ(3.0, out.the_matrix[2]);
+
+    char* packed = test_pack(&out);
+    ASSERT_TRUE(packed);
+
+    ASSERT_INT_GE(0, test_unpack_reuse(&out, packed));
+    ASSERT_INT_EQ(3, out.rows_of_the_matrix);
+    ASSERT_INT_EQ(3, out.length_of_the_matrix);
+    ASSERT_DOUBLE_EQ(2.0, out.the_matrix[1]);
+
+    ASSERT_INT_LT(0, test_unpack_reuse(&out, "{\"the_matrix\": [1.0]}"));
+
+    test_cleanup(&out);
+    free(packed);
+    return 0;
+}
+
+static int test_enum()
+{
+    struct test in, out;
+    memset(&in, 0, sizeof(in));
+    in.is_set_the_status = 1;
+    in.the_status = TEST_THE_STATUS_DEGRADED;
+
+    char* json = test_pack(&in);
+    ASSERT_TRUE(json);
+    ASSERT_TRUE(strstr(json, "\"the_status\":\"degraded\""));
+
+    ASSERT_INT_GE(0, test_unpack(&out, json));
+    ASSERT_TRUE(out.is_set_the_status);
+    ASSERT_INT_EQ(TEST_THE_STATUS_DEGRADED, out.the_status);
+
+    ASSERT_INT_GE(0, test_unpack_reuse(&out,
+        "{\"the_items\": [{\"the_id\": 1, \"the_kind\": \"large\"}]}"));
+    ASSERT_INT_EQ(TEST_THE_ITEMS__THE_KIND_LARGE, out.the_items[0].the_kind);
+
+    ASSERT_INT_LT(0, test_unpack_reuse(&out, "{\"the_status\": \"up\"}"));
+    ASSERT_INT_LT(0, test_unpack_reuse(&out, "{\"the_status\": \"dow\"}"));
+
+    test_cleanup(&out);
+    free(json);
+    return 0;
+}
+
+static int test_interned()
+{
+    struct json_intern table;
+    ASSERT_INT_EQ(0, json_intern_init(&table));
+
+    const char* json = "{\"the_items\": ["
+        "{\"the_id\": 1, \"the_host\": \"alpha\"},"
+        "{\"the_id\": 2, \"the_host\": \"beta\"},"
+        "{\"the_id\": 3, \"the_host\": \"alpha\"}]}";
+
+    struct test out;
+    memset(&out, 0, sizeof(out));
+    out.intern_table = &table;
+
+    ASSERT_INT_GE(0, test_unpack(&out, json));
+    ASSERT_TRUE(out.intern_table == &table);
+    ASSERT_INT_EQ(3, out.length_of_the_items);
+    ASSERT_TRUE(out.the_items[0].is_set_the_host);
+    ASSERT_STR_EQ("alpha", out.the_items[0].the_host);
+    ASSERT_STR_EQ("beta", out.the_items[1].the_host);
+    ASSERT_TRUE(out.the_items[0].the_host == out.the_items[2].the_host);
+    ASSERT_INT_EQ(2, json_intern_length(&table));
+
+    ASSERT_INT_GE(0, test_unpack_reuse(&out, json));
+    ASSERT_TRUE(out.the_items[0].the_host == json_intern(&table, "alpha", 5));
+    ASSERT_INT_EQ(2, json_intern_length(&table));
+
+    char* packed = test_pack(&out);
+    ASSERT_TRUE(packed);
+    ASSERT_TRUE(strstr(packed, "\"the_host\":\"beta\""));
+    free(packed);
+
+    /* Interned members cannot be unpacked without a table */
+    out.intern_table = NULL;
+    ASSERT_INT_LT(0, test_unpack_reuse(&out, json));
+
+    test_cleanup(&out);
+    json_intern_cleanup(&table);
+    return 0;
+}
+
+static int test_inline_string()
+{
+    struct test in, out;
+    memset(&in, 0, sizeof(in));
+    in.is_set_the_label = 1;
+    strcpy(in.the_label, "a\"b");
+    in.length_of_the_label = 3;
+
+    char* json = test_pack(&in);
+    ASSERT_TRUE(json);
+    ASSERT_TRUE(strstr(json, "\"the_label\":\"a\\\"b\""));
+
+    ASSERT_INT_EQ(5, sizeof(out.the_label));
+    ASSERT_INT_GE(0, test_unpack(&out, json));
+    ASSERT_TRUE(out.is_set_the_label);
+    ASSERT_STR_EQ("a\"b", (const char*)out.the_label);
+    ASSERT_INT_EQ(3, out.length_of_the_label);
+
+    ASSERT_INT_GE(0, test_unpack_reuse(&out, "{\"the_label\": \"abcd\"}"));
+    ASSERT_STR_EQ("abcd", (const char*)out.the_label);
+    ASSERT_INT_EQ(4, out.length_of_the_label);
+    ASSERT_INT_LT(0, test_unpack_reuse(&out, "{\"the_label\": \"abcde\"}"));
+
+    ASSERT_INT_GE(0, test_unpack_reuse(&out,
+        "{\"the_items\": [{\"the_id\": 1, \"the_code\": \"XK-12\"}]}"));
+    ASSERT_STR_EQ("XK-12", (const char*)out.the_items[0].the_code);
+    ASSERT_INT_EQ(5, out.the_items[0].length_of_the_code);
+
+    test_cleanup(&out);
+    free(json);
+    return 0;
+}
+
 int main()
 {
     int r = 0;
     RUN_TEST(test_integer);
     RUN_TEST(test_real);
+    RUN_TEST(test_real_roundtrip);
     RUN_TEST(test_bool);
     RUN_TEST(test_string);
     RUN_TEST(test_object);
     RUN_TEST(test_any);
+    RUN_TEST(test_any_object);
     RUN_TEST(test_array);
+    RUN_TEST(test_large_array);
+    RUN_TEST(test_caller_buffer);
+    RUN_TEST(test_stream_pack);
+    RUN_TEST(test_many_records);
+    RUN_TEST(test_many_records_any);
+    RUN_TEST(test_parallel_records);
+    RUN_TEST(test_sized_numbers);
+    RUN_TEST(test_sized_numbers_out_of_range);
+    RUN_TEST(test_reuse);
+    RUN_TEST(test_stream);
+    RUN_TEST(test_object_array);
+    RUN_TEST(test_object_array_names);
+    RUN_TEST(test_pack_keys);
+    RUN_TEST(test_columnar);
+    RUN_TEST(test_nested_array);
+    RUN_TEST(test_enum);
+    RUN_TEST(test_interned);
+    RUN_TEST(test_inline_string);
     return r;
 }
 
@@ -0,0 +1,221 @@
+#include <stdlib.h>
+#include <string.h>
+#include "tst.h"
+#include "json_buffer.h"
+
+static int test_append()
+{
+    struct json_buffer buffer;
+    ASSERT_INT_EQ(0, json_buffer_init(&buffer, 0));
+    ASSERT_STR_EQ("", buffer.data);
+
+    ASSERT_INT_EQ(0, json_buffer_append(&buffer, "{}", 2));
+    ASSERT_INT_EQ(0, json_buffer_append(&buffer, "[]", 2));
+    ASSERT_INT_EQ(4, buffer.length);
+    ASSERT_STR_EQ("{}[]", buffer.data);
+
+    json_buffer_cleanup(&buffer);
+    return 0;
+}
+
+static int print_number_and_string(struct json_buffer* buffer)
+{
+    if(json_buffer_printf(buffer, "%d", 42) < 0)
+        return -1;
+
+    return json_buffer_printf(buffer, "\"%s\"", "a long string");
+}
+
+static int test_printf_grows()
+{
+    struct json_buffer buffer;
+    ASSERT_INT_EQ(0, json_buffer_init(&buffer, 4));
+
+    ASSERT_INT_EQ(0, print_number_and_string(&buffer));
+    ASSERT_STR_EQ("42\"a long string\"", buffer.data);
+    ASSERT_INT_EQ(17, buffer.length);
+
+    json_buffer_cleanup(&buffer);
+    return 0;
+}
+
+static int test_amortized_growth()
+{
+    struct json_buffer buffer;
+    ASSERT_INT_EQ(0, json_buffer_init(&buffer, 16));
+
+    int reallocations = 0;
+    size_t reserved_size = buffer.reserved_size;
+    int i;
+
+    for(i = 0; i < 100000; ++i)
+    {
+        ASSERT_INT_EQ(0, json_buffer_append(&buffer, "1,", 2));
+        if(buffer.reserved_size != reserved_size)
+        {
+            reserved_size = buffer.reserved_size;
+            ++reallocations;
+        }
+    }
+
+    ASSERT_INT_EQ(200000, buffer.length);
+    ASSERT_TRUE(reallocations < 20);
+
+    json_buffer_cleanup(&buffer);
+    return 0;
+}
+
+static int test_release()
+{
+    struct json_buffer buffer;
+    ASSERT_INT_EQ(0, json_buffer_init(&buffer, 8));
+    ASSERT_INT_EQ(0, json_buffer_append(&buffer, "null", 4));
+
+    char* data = json_buffer_release(&buffer);
+    ASSERT_STR_EQ("null", data);
+    ASSERT_FALSE(buffer.data);
+
+    free(data);
+    return 0;
+}
+
+static int test_fixed()
+{
+    char data[8];
+    memset(data, 'x', sizeof(data));
+
+    struct json_buffer buffer;
+    json_buffer_init_fixed(&buffer, data, 6);
+
+    ASSERT_INT_EQ(0, json_buffer_append(&buffer, "[1,", 3));
+    ASSERT_STR_EQ("[1,", (const char*)data);
+    ASSERT_INT_EQ(0, json_buffer_append(&buffer, "2,", 2));
+    ASSERT_STR_EQ("[1,2,", (const char*)data);
+
+    ASSERT_INT_EQ(0, json_buffer_append(&buffer, "3]", 2));
+    ASSERT_INT_EQ(0, json_buffer_append(&buffer, "", 0));
+    ASSERT_INT_EQ(7, buffer.length);
+    ASSERT_INT_EQ('x', data[6]);
+    ASSERT_INT_EQ(-1, json_buffer_reserve(&buffer, 1));
+
+    json_buffer_cleanup(&buffer);
+    return 0;
+}
+
+static int test_counting()
+{
+    struct json_buffer buffer;
+    json_buffer_init_fixed(&buffer, NULL, 0);
+
+    ASSERT_INT_EQ(0, json_buffer_append(&buffer, "true", 4));
+    ASSERT_INT_EQ(0, print_number_and_string(&buffer));
+    ASSERT_INT_EQ(21, buffer.length);
+
+    json_buffer_cleanup(&buffer);
+    return 0;
+}
+
+static int test_append_string()
+{
+    struct json_buffer buffer;
+    ASSERT_INT_EQ(0, json_buffer_init(&buffer, 0));
+
+    const char* str = "a \"quoted\" line\n";
+    ASSERT_INT_EQ(0, json_buffer_append_string(&buffer, str, strlen(str)));
+    ASSERT_INT_EQ(0, json_buffer_append_string(&buffer, "", 0));
+    ASSERT_STR_EQ("\"a \\\"quoted\\\" line\\n\"\"\"", buffer.data);
+
+    json_buffer_cleanup(&buffer);
+    return 0;
+}
+
+static int test_append_json()
+{
+    struct json_buffer buffer;
+    ASSERT_INT_EQ(0, json_buffer_init(&buffer, 0));
+
+    const char* json = "{ \"a b\": [1,\n\t2],\r\n \"c\\\" d\": \" \" }";
+    ASSERT_INT_EQ(0, json_buffer_append_json(&buffer, json, strlen(json)));
+    ASSERT_STR_EQ(json, buffer.data);
+
+    buffer.length = 0;
+    buffer.is_compact = 1;
+    ASSERT_INT_EQ(0, json_buffer_append_json(&buffer, json, strlen(json)));
+    ASSERT_STR_EQ("{\"a b\":[1,2],\"c\\\" d\":\" \"}", buffer.data);
+
+    json_buffer_cleanup(&buffer);
+    return 0;
+}
+
+struct sink {
+    char data[256];
+    size_t length;
+    int writes;
+    int max_count;
+};
+
+static int write_sink(void* ctx, const struct iovec* iov, int count)
+{
+    struct sink* sink = ctx;
+    int i;
+
+    for(i = 0; i < count; ++i)
+    {
+        memcpy(&sink->data[sink->length], iov[i].iov_base, iov[i].iov_len);
+        sink->length += iov[i].iov_len;
+    }
+
+    sink->writes++;
+    if(count > sink->max_count)
+        sink->max_count = count;
+
+    return 0;
+}
+
+static int test_stream()
+{
+    struct sink sink;
+    memset(&sink, 0, sizeof(sink));
+
+    struct json_buffer buffer;
+    ASSERT_INT_EQ(0, json_buffer_init_stream(&buffer, 8, write_sink, &sink));
+
+    ASSERT_INT_EQ(0, json_buffer_append(&buffer, "[1,", 3));
+    ASSERT_INT_EQ(0, json_buffer_append(&buffer, "22,", 3));
+    ASSERT_INT_EQ(0, sink.writes);
+    ASSERT_INT_EQ(0, json_buffer_append(&buffer, "333,", 4));
+    ASSERT_INT_EQ(1, sink.writes);
+
+    /* Large chunks are passed on along with the buffered data */
+    ASSERT_INT_EQ(0, json_buffer_append_string(&buffer, "a long string", 13));
+    ASSERT_INT_EQ(2, sink.max_count);
+
+    ASSERT_INT_EQ(0, json_buffer_append_integer(&buffer, 4444));
+    ASSERT_INT_EQ(0, json_buffer_append(&buffer, "]", 1));
+    ASSERT_INT_EQ(0, json_buffer_flush(&buffer));
+
+    sink.data[sink.length] = '\0';
+    ASSERT_STR_EQ("[1,22,333,\"a long string\"4444]", (const char*)sink.data);
+    ASSERT_INT_EQ(sink.length, buffer.flushed);
+    ASSERT_INT_EQ(0, buffer.length);
+
+    json_buffer_cleanup(&buffer);
+    return 0;
+}
+
+int main(int argc, char* argv[])
+{
+    int r = 0;
+
+    RUN_TEST(test_append);
+    RUN_TEST(test_printf_grows);
+    RUN_TEST(test_amortized_growth);
+    RUN_TEST(test_release);
+    RUN_TEST(test_fixed);
+    RUN_TEST(test_counting);
+    RUN_TEST(test_append_string);
+    RUN_TEST(test_append_json);
+    RUN_TEST(test_stream);
+
+    return r;
+}
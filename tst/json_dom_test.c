@@ -0,0 +1,150 @@
+#include <stdlib.h>
+#include <string.h>
+#include "tst.h"
+#include "json_dom.h"
+
+static int parse(struct json_dom* dom, const char* json)
+{
+    return json_dom_parse(dom, json, strlen(json));
+}
+
+static int span_eq(const struct json_dom* dom, const struct json_span* span,
+                   const char* str)
+{
+    return span->length == strlen(str)
+        && 0 == memcmp(&dom->input[span->start], str, span->length);
+}
+
+static int test_scalar()
+{
+    struct json_dom dom;
+    memset(&dom, 0, sizeof(dom));
+
+    ASSERT_INT_EQ(0, parse(&dom, " -12 "));
+    ASSERT_INT_EQ(1, dom.length);
+    ASSERT_INT_EQ(JSON_OBJ_INTEGER, dom.nodes[0].type);
+    ASSERT_INT_EQ(-12, json_dom_integer(&dom, 0));
+
+    ASSERT_INT_EQ(0, parse(&dom, "1.5e3"));
+    ASSERT_INT_EQ(JSON_OBJ_REAL, dom.nodes[0].type);
+    ASSERT_DOUBLE_EQ(1500.0, json_dom_real(&dom, 0));
+
+    json_dom_cleanup(&dom);
+    return 0;
+}
+
+static int test_unterminated_input()
+{
+    struct json_dom dom;
+    memset(&dom, 0, sizeof(dom));
+
+    const char json[] = { '[', '1', ',', '2', '3' };
+    ASSERT_INT_EQ(-1, json_dom_parse(&dom, json, sizeof(json)));
+    ASSERT_INT_EQ(0, json_dom_parse(&dom, "[1,23]", 6));
+    ASSERT_INT_EQ(23, json_dom_integer(&dom, 2));
+
+    json_dom_cleanup(&dom);
+    return 0;
+}
+
+static int test_tree()
+{
+    struct json_dom dom;
+    memset(&dom, 0, sizeof(dom));
+
+    const char* json = "{\"a\": [1, {\"b\": \"x\\ny\"}, []], \"c\": true, \"d\": null}";
+    ASSERT_INT_EQ(0, parse(&dom, json));
+    ASSERT_INT_EQ(8, dom.length);
+    ASSERT_INT_EQ(JSON_OBJ_OBJECT, dom.nodes[0].type);
+    ASSERT_INT_EQ(3, dom.nodes[0].length);
+    ASSERT_TRUE(span_eq(&dom, &dom.nodes[0].value, json));
+
+    uint32_t a = json_dom_member(&dom, 0, "a");
+    ASSERT_INT_EQ(1, a);
+    ASSERT_INT_EQ(JSON_OBJ_ARRAY, dom.nodes[a].type);
+    ASSERT_TRUE(span_eq(&dom, &dom.nodes[a].value, "[1, {\"b\": \"x\\ny\"}, []]"));
+
+    uint32_t one = json_dom_first_child(&dom, a);
+    uint32_t object = json_dom_next_sibling(&dom, one);
+    uint32_t empty = json_dom_next_sibling(&dom, object);
+    ASSERT_INT_EQ(JSON_DOM_NONE, json_dom_next_sibling(&dom, empty));
+    ASSERT_INT_EQ(JSON_DOM_NONE, json_dom_first_child(&dom, empty));
+    ASSERT_INT_EQ(a, dom.nodes[empty].parent);
+
+    uint32_t b = json_dom_member(&dom, object, "b");
+    ASSERT_TRUE(span_eq(&dom, &dom.nodes[b].key, "b"));
+    ASSERT_TRUE(span_eq(&dom, &dom.nodes[b].value, "x\\ny"));
+
+    char* str = json_dom_string(&dom, b);
+    ASSERT_STR_EQ("x\ny", str);
+    free(str);
+
+    uint32_t c = json_dom_next_sibling(&dom, a);
+    ASSERT_TRUE(span_eq(&dom, &dom.nodes[c].key, "c"));
+    ASSERT_INT_EQ(JSON_OBJ_BOOL, dom.nodes[c].type);
+    ASSERT_TRUE(span_eq(&dom, &dom.nodes[c].value, "true"));
+
+    uint32_t d = json_dom_member(&dom, 0, "d");
+    ASSERT_INT_EQ(JSON_OBJ_NULL, dom.nodes[d].type);
+    ASSERT_INT_EQ(JSON_DOM_NONE, json_dom_next_sibling(&dom, d));
+    ASSERT_INT_EQ(JSON_DOM_NONE, json_dom_member(&dom, 0, "e"));
+
+    json_dom_cleanup(&dom);
+    return 0;
+}
+
+static int test_deep_nesting()
+{
+    struct json_dom dom;
+    memset(&dom, 0, sizeof(dom));
+
+    size_t depth = 1000000;
+    char* json = malloc(depth * 2);
+    ASSERT_TRUE(json);
+    memset(json, '[', depth);
+    memset(json + depth, ']', depth);
+
+    ASSERT_INT_EQ(0, json_dom_parse(&dom, json, depth * 2));
+    ASSERT_INT_EQ(depth, dom.length);
+    ASSERT_INT_EQ(depth, dom.nodes[0].next);
+    ASSERT_INT_EQ(depth - 2, dom.nodes[depth - 1].parent);
+
+    free(json);
+    json_dom_cleanup(&dom);
+    return 0;
+}
+
+static int test_invalid()
+{
+    struct json_dom dom;
+    memset(&dom, 0, sizeof(dom));
+
+    ASSERT_INT_EQ(-1, parse(&dom, ""));
+    ASSERT_INT_EQ(-1, parse(&dom, "[1, 2"));
+    ASSERT_INT_EQ(-1, parse(&dom, "[1,]"));
+    ASSERT_INT_EQ(-1, parse(&dom, "[1}"));
+    ASSERT_INT_EQ(-1, parse(&dom, "{\"a\" 1}"));
+    ASSERT_INT_EQ(-1, parse(&dom, "{1: 1}"));
+    ASSERT_INT_EQ(-1, parse(&dom, "[01]"));
+    ASSERT_INT_EQ(-1, parse(&dom, "[1.]"));
+    ASSERT_INT_EQ(-1, parse(&dom, "[tru]"));
+    ASSERT_INT_EQ(-1, parse(&dom, "[\"\\x\"]"));
+    ASSERT_INT_EQ(-1, parse(&dom, "[\"\\u12g4\"]"));
+    ASSERT_INT_EQ(-1, parse(&dom, "[] []"));
+
+    json_dom_cleanup(&dom);
+    return 0;
+}
+
+int main(int argc, char* argv[])
+{
+    int r = 0;
+
+    RUN_TEST(test_scalar);
+    RUN_TEST(test_unterminated_input);
+    RUN_TEST(test_tree);
+    RUN_TEST(test_deep_nesting);
+    RUN_TEST(test_invalid);
+
+    return r;
+}
@@ -0,0 +1,111 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "tst.h"
+#include "json_format.h"
+
+static char buffer_[JSON_FORMAT_REAL_SIZE + 1];
+
+static const char* integer(long long value)
+{
+    buffer_[json_format_integer(buffer_, value)] = '\0';
+    return buffer_;
+}
+
+static const char* real(double value)
+{
+    buffer_[json_format_real(buffer_, value)] = '\0';
+    return buffer_;
+}
+
+static const char* real32(float value)
+{
+    buffer_[json_format_float(buffer_, value)] = '\0';
+    return buffer_;
+}
+
+static int test_integer()
+{
+    ASSERT_STR_EQ("0", integer(0));
+    ASSERT_STR_EQ("7", integer(7));
+    ASSERT_STR_EQ("10", integer(10));
+    ASSERT_STR_EQ("-100", integer(-100));
+    ASSERT_STR_EQ("1234567", integer(1234567));
+    ASSERT_STR_EQ("9223372036854775807", integer(INT64_MAX));
+    ASSERT_STR_EQ("-9223372036854775808", integer(INT64_MIN));
+
+    buffer_[json_format_unsigned(buffer_, UINT64_MAX)] = '\0';
+    ASSERT_STR_EQ("18446744073709551615", (const char*)buffer_);
+    return 0;
+}
+
+static int test_real()
+{
+    ASSERT_STR_EQ("0.0", real(0.0));
+    ASSERT_STR_EQ("-0.0", real(-0.0));
+    ASSERT_STR_EQ("1.0", real(1.0));
+    ASSERT_STR_EQ("0.1", real(0.1));
+    ASSERT_STR_EQ("-2.5", real(-2.5));
+    ASSERT_STR_EQ("123.456", real(123.456));
+    ASSERT_STR_EQ("0.000001", real(1e-6));
+    ASSERT_STR_EQ("1e-7", real(1e-7));
+    ASSERT_STR_EQ("100000000000000000000.0", real(1e20));
+    ASSERT_STR_EQ("1e21", real(1e21));
+    ASSERT_STR_EQ("1.5e300", real(1.5e300));
+    ASSERT_STR_EQ("5e-324", real(5e-324));
+    ASSERT_STR_EQ("1.7976931348623157e308", real(1.7976931348623157e308));
+    ASSERT_STR_EQ("null", real(1.0 / 0.0));
+    return 0;
+}
+
+static int test_float()
+{
+    ASSERT_STR_EQ("0.1", real32(0.1f));
+    ASSERT_STR_EQ("3.14159", real32(3.14159f));
+    ASSERT_STR_EQ("16777216.0", real32(16777216.0f));
+    ASSERT_STR_EQ("3.4028235e38", real32(3.4028235e38f));
+    ASSERT_STR_EQ("1e-45", real32(1e-45f));
+    return 0;
+}
+
+static int is_roundtrip(double value)
+{
+    double res = strtod(real(value), NULL);
+    return memcmp(&res, &value, sizeof(value)) == 0;
+}
+
+static int test_roundtrip()
+{
+    uint64_t bits = 88172645463325252ULL;
+    int i;
+
+    for(i = 0; i < 100000; ++i)
+    {
+        /* xorshift64 */
+        bits ^= bits << 13;
+        bits ^= bits >> 7;
+        bits ^= bits << 17;
+
+        double value;
+        memcpy(&value, &bits, sizeof(value));
+        if(value != value || value - value != 0.0)
+            continue;
+
+        ASSERT_TRUE(is_roundtrip(value));
+    }
+
+    return 0;
+}
+
+int main(int argc, char* argv[])
+{
+    int r = 0;
+
+    RUN_TEST(test_integer);
+    RUN_TEST(test_real);
+    RUN_TEST(test_float);
+    RUN_TEST(test_roundtrip);
+
+    return r;
+}
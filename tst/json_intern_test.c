@@ -0,0 +1,135 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "tst.h"
+#include "json_intern.h"
+
+static int test_same_pointer()
+{
+    struct json_intern table;
+    ASSERT_INT_EQ(0, json_intern_init(&table));
+
+    const char* a = json_intern(&table, "host-1", 6);
+    const char* b = json_intern(&table, "host-1", 6);
+    const char* c = json_intern(&table, "host-12", 6);
+    const char* d = json_intern(&table, "host-2", 6);
+
+    ASSERT_TRUE(a);
+    ASSERT_STR_EQ("host-1", a);
+    ASSERT_TRUE(a == b);
+    ASSERT_TRUE(a == c);
+    ASSERT_TRUE(a != d);
+    ASSERT_INT_EQ(2, json_intern_length(&table));
+
+    json_intern_cleanup(&table);
+    return 0;
+}
+
+static int test_growth()
+{
+    struct json_intern table;
+    ASSERT_INT_EQ(0, json_intern_init(&table));
+
+    const char* first[1000];
+    char name[32];
+    int i;
+
+    for(i = 0; i < 1000; ++i)
+    {
+        snprintf(name, sizeof(name), "service-%d", i);
+        first[i] = json_intern(&table, name, strlen(name));
+        ASSERT_TRUE(first[i]);
+    }
+
+    for(i = 0; i < 1000; ++i)
+    {
+        snprintf(name, sizeof(name), "service-%d", i);
+        ASSERT_TRUE(first[i] == json_intern(&table, name, strlen(name)));
+    }
+
+    ASSERT_INT_EQ(1000, json_intern_length(&table));
+
+    json_intern_cleanup(&table);
+    return 0;
+}
+
+static int test_long_string()
+{
+    struct json_intern table;
+    ASSERT_INT_EQ(0, json_intern_init(&table));
+
+    size_t size = 100000;
+    char* str = malloc(size);
+    ASSERT_TRUE(str);
+    memset(str, 'x', size);
+
+    const char* small = json_intern(&table, "small", 5);
+    const char* large = json_intern(&table, str, size);
+    ASSERT_TRUE(large);
+    ASSERT_INT_EQ(size, strlen(large));
+    ASSERT_TRUE(small == json_intern(&table, "small", 5));
+    ASSERT_TRUE(large == json_intern(&table, str, size));
+
+    free(str);
+    json_intern_cleanup(&table);
+    return 0;
+}
+
+static int test_null_table()
+{
+    ASSERT_FALSE(json_intern(NULL, "a", 1));
+    return 0;
+}
+
+static void* intern_names(void* table)
+{
+    char name[32];
+    int i;
+
+    for(i = 0; i < 10000; ++i)
+    {
+        snprintf(name, sizeof(name), "metric-%d", i % 500);
+        if(!json_intern(table, name, strlen(name)))
+            return NULL;
+    }
+
+    return table;
+}
+
+static int test_threads()
+{
+    struct json_intern table;
+    ASSERT_INT_EQ(0, json_intern_init(&table));
+
+    pthread_t threads[4];
+    void* res;
+    int i;
+
+    for(i = 0; i < 4; ++i)
+        ASSERT_INT_EQ(0, pthread_create(&threads[i], NULL, intern_names, &table));
+
+    for(i = 0; i < 4; ++i)
+    {
+        ASSERT_INT_EQ(0, pthread_join(threads[i], &res));
+        ASSERT_TRUE(res == &table);
+    }
+
+    ASSERT_INT_EQ(500, json_intern_length(&table));
+
+    json_intern_cleanup(&table);
+    return 0;
+}
+
+int main(int argc, char* argv[])
+{
+    int r = 0;
+
+    RUN_TEST(test_same_pointer);
+    RUN_TEST(test_growth);
+    RUN_TEST(test_long_string);
+    RUN_TEST(test_null_table);
+    RUN_TEST(test_threads);
+
+    return r;
+}
@@ -0,0 +1,207 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "tst.h"
+#include "json_pool.h"
+
+#define COUNT 10000
+
+static int pack_number(const void* item, struct json_buffer* out)
+{
+    int value = *(const int*)item;
+    if(value < 0)
+        return -1;
+
+    if(json_buffer_append_integer(out, value) < 0)
+        return -1;
+
+    return json_buffer_append(out, "\n", 1);
+}
+
+static int* make_numbers()
+{
+    int* numbers = malloc(COUNT * sizeof(*numbers));
+    if(!numbers)
+        return NULL;
+
+    int i;
+    for(i = 0; i < COUNT; ++i)
+        numbers[i] = i;
+
+    return numbers;
+}
+
+/* Joins the chunks and checks that the numbers come out in order */
+static int check_batch(const struct json_batch* batch, int count)
+{
+    char* text = malloc(batch->length + 1);
+    size_t length = 0;
+    int i;
+
+    if(!text)
+        return -1;
+
+    for(i = 0; i < batch->count; ++i)
+    {
+        memcpy(&text[length], batch->iov[i].iov_base, batch->iov[i].iov_len);
+        length += batch->iov[i].iov_len;
+    }
+    text[length] = '\0';
+
+    char* next = text;
+    for(i = 0; i < count; ++i)
+    {
+        char* end;
+        if(strtol(next, &end, 10) != i || *end != '\n')
+            break;
+
+        next = end + 1;
+    }
+
+    int r = i == count && *next == '\0' && length == batch->length ? 0 : -1;
+    free(text);
+    return r;
+}
+
+static int pack_with(int threads)
+{
+    int* numbers = make_numbers();
+    ASSERT_TRUE(numbers);
+
+    struct json_pool pool;
+    ASSERT_INT_EQ(0, json_pool_init(&pool, threads));
+    ASSERT_INT_EQ(threads - 1, pool.thread_count);
+
+    struct json_batch batch;
+    ASSERT_INT_EQ(0, json_pool_pack(&pool, numbers, COUNT, sizeof(*numbers),
+                                    pack_number, &batch));
+    ASSERT_TRUE(batch.count > 1);
+    ASSERT_INT_EQ(0, check_batch(&batch, COUNT));
+    json_batch_cleanup(&batch);
+
+    /* The pool can be used again */
+    ASSERT_INT_EQ(0, json_pool_pack(&pool, numbers, 100, sizeof(*numbers),
+                                    pack_number, &batch));
+    ASSERT_INT_EQ(0, check_batch(&batch, 100));
+    json_batch_cleanup(&batch);
+
+    json_pool_cleanup(&pool);
+    free(numbers);
+    return 0;
+}
+
+static int test_single_thread()
+{
+    return pack_with(1);
+}
+
+static int test_threads()
+{
+    return pack_with(4);
+}
+
+static int test_empty()
+{
+    struct json_pool pool;
+    ASSERT_INT_EQ(0, json_pool_init(&pool, 2));
+
+    struct json_batch batch;
+    ASSERT_INT_EQ(0, json_pool_pack(&pool, NULL, 0, sizeof(int), pack_number,
+                                    &batch));
+    ASSERT_INT_EQ(0, batch.count);
+    ASSERT_INT_EQ(0, batch.length);
+    json_batch_cleanup(&batch);
+
+    json_pool_cleanup(&pool);
+    return 0;
+}
+
+static int test_failure()
+{
+    int* numbers = make_numbers();
+    ASSERT_TRUE(numbers);
+    numbers[COUNT / 2] = -1;
+
+    struct json_pool pool;
+    ASSERT_INT_EQ(0, json_pool_init(&pool, 3));
+
+    struct json_batch batch;
+    ASSERT_INT_EQ(-1, json_pool_pack(&pool, numbers, COUNT, sizeof(*numbers),
+                                     pack_number, &batch));
+    json_batch_cleanup(&batch);
+
+    json_pool_cleanup(&pool);
+    free(numbers);
+    return 0;
+}
+
+struct submitter {
+    struct json_pool* pool;
+    const int* numbers;
+    int r;
+};
+
+static void* submit(void* arg)
+{
+    struct submitter* submitter = arg;
+    struct json_batch batch;
+    int i;
+
+    for(i = 0; i < 20 && submitter->r == 0; ++i)
+    {
+        if(json_pool_pack(submitter->pool, submitter->numbers, COUNT,
+                          sizeof(int), pack_number, &batch) < 0
+           || check_batch(&batch, COUNT) < 0)
+            submitter->r = -1;
+
+        json_batch_cleanup(&batch);
+    }
+
+    return NULL;
+}
+
+static int test_shared_pool()
+{
+    int* numbers = make_numbers();
+    ASSERT_TRUE(numbers);
+
+    struct json_pool pool;
+    ASSERT_INT_EQ(0, json_pool_init(&pool, 3));
+
+    struct submitter submitters[3];
+    pthread_t threads[3];
+    int i;
+
+    for(i = 0; i < 3; ++i)
+    {
+        submitters[i].pool = &pool;
+        submitters[i].numbers = numbers;
+        submitters[i].r = 0;
+        ASSERT_INT_EQ(0, pthread_create(&threads[i], NULL, submit,
+                                        &submitters[i]));
+    }
+
+    for(i = 0; i < 3; ++i)
+    {
+        ASSERT_INT_EQ(0, pthread_join(threads[i], NULL));
+        ASSERT_INT_EQ(0, submitters[i].r);
+    }
+
+    json_pool_cleanup(&pool);
+    free(numbers);
+    return 0;
+}
+
+int main(int argc, char* argv[])
+{
+    int r = 0;
+
+    RUN_TEST(test_single_thread);
+    RUN_TEST(test_threads);
+    RUN_TEST(test_empty);
+    RUN_TEST(test_failure);
+    RUN_TEST(test_shared_pool);
+
+    return r;
+}
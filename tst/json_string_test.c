@@ -1,4 +1,5 @@
 #include <stdlib.h>
+#include <string.h>
 #include "tst.h"
 #include "json_string.h"
 
@@ -122,6 +123,110 @@ static int test_encode_non_printable()
     return 0;
 }
 
+static int test_encode_long_string()
+{
+    char* out = encode("0123456789abcdef0123456789\"abcdef\x1f" "0123456789abcdef\\");
+    ASSERT_TRUE(out);
+
+    ASSERT_STR_EQ("0123456789abcdef0123456789\\\"abcdef\\u001f0123456789abcdef\\\\", out);
+
+    free(out);
+    return 0;
+}
+
+static int test_encode_utf8()
+{
+    char* out = encode("bl\xc3\xa1r \x7f");
+    ASSERT_TRUE(out);
+
+    ASSERT_STR_EQ("bl\xc3\xa1r \\u007f", out);
+
+    free(out);
+    return 0;
+}
+
+static int test_find_escape()
+{
+    ASSERT_INT_EQ(0, json_string_find_escape("", 0));
+    ASSERT_INT_EQ(3, json_string_find_escape("abc", 3));
+    ASSERT_INT_EQ(1, json_string_find_escape("a\nc", 3));
+    ASSERT_INT_EQ(20, json_string_find_escape("aaaaaaaaaaaaaaaaaaaa\tbbbbbbbbbbbbbbbbbbb", 40));
+    ASSERT_INT_EQ(32, json_string_find_escape("\xff\xfe\x80\x81" "aaaaaaaaaaaaaaaaaaaaaaaaaaaa", 32));
+    return 0;
+}
+
+static int test_decode_into()
+{
+    char buffer[16];
+    memset(buffer, 'x', sizeof(buffer));
+
+    ASSERT_INT_EQ(7, json_string_decode_into(buffer, sizeof(buffer), "a\\tb\\u0041cd", 13));
+    ASSERT_STR_EQ("a\tbAcd", (const char*)buffer);
+
+    /* Output that does not fit is only counted */
+    memset(buffer, 'x', sizeof(buffer));
+    ASSERT_INT_EQ(7, json_string_decode_into(buffer, 4, "a\\tb\\u0041cd", 13));
+    ASSERT_STR_EQ("a\tb", (const char*)buffer);
+    ASSERT_INT_EQ('x', buffer[4]);
+
+    ASSERT_INT_EQ(3, json_string_decode_into(NULL, 0, "abc", 3));
+
+    /* Only 'len' bytes are read */
+    ASSERT_INT_EQ(2, json_string_decode_into(buffer, sizeof(buffer), "ab\\n", 2));
+    ASSERT_STR_EQ("ab", (const char*)buffer);
+    return 0;
+}
+
+static int test_encode_into()
+{
+    const char* input = "a\"b\x01" "c";
+    char buffer[16];
+    memset(buffer, 'x', sizeof(buffer));
+
+    ASSERT_INT_EQ(11, json_string_encoded_length(input, 5));
+    ASSERT_INT_EQ(11, json_string_encode_into(buffer, sizeof(buffer), input, 5));
+    ASSERT_STR_EQ("a\\\"b\\u0001c", (const char*)buffer);
+
+    memset(buffer, 'x', sizeof(buffer));
+    ASSERT_INT_EQ(11, json_string_encode_into(buffer, 6, input, 5));
+    ASSERT_STR_EQ("a\\\"b\\", (const char*)buffer);
+    ASSERT_INT_EQ('x', buffer[6]);
+
+    ASSERT_INT_EQ(11, json_string_encode_into(NULL, 0, input, 5));
+    ASSERT_INT_EQ(0, json_string_encoded_length("", 0));
+    ASSERT_INT_EQ(36, json_string_encoded_length("0123456789abcdef0123456789abcdef\n\t", 34));
+    return 0;
+}
+
+static int test_decode_unicode()
+{
+    char* out = decode("\\u00e9\\u00C9\\u20AC\\ud83d\\ude00\\udc00");
+    ASSERT_TRUE(out);
+
+    ASSERT_STR_EQ("\xc3\xa9\xc3\x89\xe2\x82\xac\xf0\x9f\x98\x80\xef\xbf\xbd", out);
+
+    free(out);
+
+    ASSERT_FALSE(decode("\\u12"));
+    ASSERT_FALSE(decode("\\uzzzz"));
+    return 0;
+}
+
+static int test_utf8_length()
+{
+    ASSERT_INT_EQ(1, json_string_utf8_length("a", 1));
+    ASSERT_INT_EQ(2, json_string_utf8_length("\xc3\xa9", 2));
+    ASSERT_INT_EQ(3, json_string_utf8_length("\xe2\x82\xac", 3));
+    ASSERT_INT_EQ(4, json_string_utf8_length("\xf0\x9f\x98\x80", 4));
+    ASSERT_INT_EQ(0, json_string_utf8_length("\xf0\x9f\x98", 3));
+    ASSERT_INT_EQ(0, json_string_utf8_length("\x80", 1));
+    ASSERT_INT_EQ(0, json_string_utf8_length("\xc1\xbf", 2));
+    ASSERT_INT_EQ(0, json_string_utf8_length("\xed\xbf\xbf", 3));
+    ASSERT_INT_EQ(0, json_string_utf8_length("\xf4\x90\x80\x80", 4));
+    ASSERT_INT_EQ(0, json_string_utf8_length("", 0));
+    return 0;
+}
+
 int main(int argc, char* argv[])
 {
     int r = 0;
@@ -138,6 +243,13 @@ int main(int argc, char* argv[])
     RUN_TEST(test_encode_newline_string);
     RUN_TEST(test_encode_backslash_string);
     RUN_TEST(test_encode_non_printable);
+    RUN_TEST(test_encode_long_string);
+    RUN_TEST(test_encode_utf8);
+    RUN_TEST(test_find_escape);
+    RUN_TEST(test_decode_into);
+    RUN_TEST(test_encode_into);
+    RUN_TEST(test_decode_unicode);
+    RUN_TEST(test_utf8_length);
 
     return r;
 }
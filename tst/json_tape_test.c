@@ -0,0 +1,200 @@
+#include <stdlib.h>
+#include <string.h>
+#include "tst.h"
+#include "jslex.h"
+#include "json_tape.h"
+
+static int parse_utf8(struct json_tape* tape, const char* json,
+                      int validate_utf8)
+{
+    struct jslex lexer;
+    if(jslex_init(&lexer, json) < 0)
+        return -1;
+
+    lexer.validate_utf8 = validate_utf8;
+    int r = json_tape_parse(tape, &lexer);
+
+    jslex_cleanup(&lexer);
+    return r;
+}
+
+static int parse(struct json_tape* tape, const char* json)
+{
+    struct jslex lexer;
+    if(jslex_init(&lexer, json) < 0)
+        return -1;
+
+    int r = json_tape_parse(tape, &lexer);
+
+    jslex_cleanup(&lexer);
+    return r;
+}
+
+static int test_scalar()
+{
+    struct json_tape tape;
+    memset(&tape, 0, sizeof(tape));
+
+    ASSERT_INT_EQ(0, parse(&tape, "42"));
+    ASSERT_INT_EQ(1, tape.length);
+    ASSERT_INT_EQ(JSON_OBJ_INTEGER, json_tape_root(&tape)->type);
+    ASSERT_INT_EQ(42, json_tape_root(&tape)->value.integer);
+
+    json_tape_cleanup(&tape);
+    return 0;
+}
+
+static int test_object()
+{
+    struct json_tape tape;
+    memset(&tape, 0, sizeof(tape));
+
+    ASSERT_INT_EQ(0, parse(&tape,
+        "{\"a\": [1, 2.5, {\"b\": null}], \"c\": \"d\", \"e\": true}"));
+    ASSERT_INT_EQ(8, tape.length);
+
+    const struct json_tape_node* root = json_tape_root(&tape);
+    ASSERT_INT_EQ(JSON_OBJ_OBJECT, root->type);
+    ASSERT_INT_EQ(3, root->length);
+    ASSERT_INT_EQ(8, root->next);
+
+    const struct json_tape_node* a = json_tape_member(&tape, root, "a");
+    ASSERT_TRUE(a);
+    ASSERT_INT_EQ(JSON_OBJ_ARRAY, a->type);
+    ASSERT_INT_EQ(3, a->length);
+    ASSERT_DOUBLE_EQ(2.5, json_tape_child(&tape, a, 1)->value.real);
+
+    const struct json_tape_node* b = json_tape_child(&tape, a, 2);
+    ASSERT_INT_EQ(JSON_OBJ_OBJECT, b->type);
+    ASSERT_STR_EQ("b", json_tape_key(&tape, b + 1));
+    ASSERT_INT_EQ(JSON_OBJ_NULL, b[1].type);
+
+    const struct json_tape_node* c = json_tape_next(&tape, a);
+    ASSERT_STR_EQ("c", json_tape_key(&tape, c));
+    ASSERT_STR_EQ("d", json_tape_string(&tape, c));
+
+    const struct json_tape_node* e = json_tape_child(&tape, root, 2);
+    ASSERT_STR_EQ("e", json_tape_key(&tape, e));
+    ASSERT_TRUE(e->value.boolean);
+    ASSERT_FALSE(json_tape_next(&tape, e));
+
+    ASSERT_FALSE(json_tape_member(&tape, root, "x"));
+    ASSERT_FALSE(json_tape_child(&tape, root, 3));
+
+    json_tape_cleanup(&tape);
+    return 0;
+}
+
+static int test_text()
+{
+    struct json_tape tape;
+    memset(&tape, 0, sizeof(tape));
+
+    struct jslex lexer;
+    ASSERT_INT_EQ(0, jslex_init(&lexer, "  [ {}, [] ] , 1"));
+    ASSERT_INT_EQ(0, json_tape_parse(&tape, &lexer));
+    ASSERT_LSTR_EQ("[ {}, [] ]", tape.text, tape.text_length);
+    ASSERT_INT_EQ(JSLEX_COMMA, jslex_next_token(&lexer)->type);
+    jslex_cleanup(&lexer);
+
+    json_tape_cleanup(&tape);
+    return 0;
+}
+
+static int test_deep_nesting()
+{
+    struct json_tape tape;
+    memset(&tape, 0, sizeof(tape));
+
+    size_t depth = 100000;
+    char* json = malloc(depth * 2 + 1);
+    ASSERT_TRUE(json);
+    memset(json, '[', depth);
+    memset(json + depth, ']', depth);
+    json[depth * 2] = 0;
+
+    ASSERT_INT_EQ(0, parse(&tape, json));
+    ASSERT_INT_EQ(depth, tape.length);
+    ASSERT_INT_EQ(depth, tape.nodes[0].next);
+    ASSERT_INT_EQ(0, tape.nodes[depth - 1].length);
+
+    free(json);
+    json_tape_cleanup(&tape);
+    return 0;
+}
+
+static int test_invalid()
+{
+    struct json_tape tape;
+    memset(&tape, 0, sizeof(tape));
+
+    ASSERT_INT_EQ(-1, parse(&tape, "[1, 2"));
+    ASSERT_INT_EQ(-1, parse(&tape, "{\"a\" 1}"));
+    ASSERT_INT_EQ(-1, parse(&tape, "{1: 1}"));
+    ASSERT_INT_EQ(-1, parse(&tape, "[1}"));
+    ASSERT_INT_EQ(-1, parse(&tape, "[1,]"));
+    ASSERT_INT_EQ(-1, parse(&tape, "[nope]"));
+
+    json_tape_cleanup(&tape);
+    return 0;
+}
+
+static int test_unicode_escapes()
+{
+    struct json_tape tape;
+    memset(&tape, 0, sizeof(tape));
+
+    ASSERT_INT_EQ(0, parse(&tape, "\"\\u0041\\u00e9\\u00C9\\u20ac\\/\""));
+    ASSERT_STR_EQ("A\xc3\xa9\xc3\x89\xe2\x82\xac/", json_tape_string(&tape, json_tape_root(&tape)));
+
+    /* Surrogate pairs make up one character, unpaired ones are replaced */
+    ASSERT_INT_EQ(0, parse(&tape, "\"\\ud83d\\ude00 \\ud800 \\udc00\""));
+    ASSERT_STR_EQ("\xf0\x9f\x98\x80 \xef\xbf\xbd \xef\xbf\xbd", json_tape_string(&tape, json_tape_root(&tape)));
+
+    ASSERT_INT_LT(0, parse(&tape, "\"\\u00g0\""));
+    ASSERT_INT_LT(0, parse(&tape, "\"\\u00\""));
+    ASSERT_INT_LT(0, parse(&tape, "\"\\x\""));
+
+    json_tape_cleanup(&tape);
+    return 0;
+}
+
+static int test_utf8_validation()
+{
+    struct json_tape tape;
+    memset(&tape, 0, sizeof(tape));
+
+    const char* valid = "\"0123456789abcdef bl\xc3\xa1r \xe2\x82\xac \xf0\x9f\x98\x80 0123456789abcdef\"";
+    ASSERT_INT_EQ(0, parse_utf8(&tape, valid, 1));
+    ASSERT_INT_EQ(0, strncmp(valid + 1, json_tape_string(&tape, json_tape_root(&tape)), strlen(valid) - 2));
+
+    /* Truncated, overlong, surrogate and out of range sequences */
+    ASSERT_INT_LT(0, parse_utf8(&tape, "\"0123456789abcdef \xc3\"", 1));
+    ASSERT_INT_LT(0, parse_utf8(&tape, "\"\xc0\xaf\"", 1));
+    ASSERT_INT_LT(0, parse_utf8(&tape, "\"\xe0\x80\xaf\"", 1));
+    ASSERT_INT_LT(0, parse_utf8(&tape, "\"\xed\xa0\x80\"", 1));
+    ASSERT_INT_LT(0, parse_utf8(&tape, "\"\xf4\x90\x80\x80\"", 1));
+    ASSERT_INT_LT(0, parse_utf8(&tape, "\"\xff\"", 1));
+
+    /* Bytes are passed through unless validating */
+    ASSERT_INT_EQ(0, parse_utf8(&tape, "\"\xff\"", 0));
+    ASSERT_STR_EQ("\xff", json_tape_string(&tape, json_tape_root(&tape)));
+
+    json_tape_cleanup(&tape);
+    return 0;
+}
+
+int main(int argc, char* argv[])
+{
+    int r = 0;
+
+    RUN_TEST(test_scalar);
+    RUN_TEST(test_object);
+    RUN_TEST(test_text);
+    RUN_TEST(test_deep_nesting);
+    RUN_TEST(test_invalid);
+    RUN_TEST(test_unicode_escapes);
+    RUN_TEST(test_utf8_validation);
+
+    return r;
+}
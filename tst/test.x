@@ -7,3 +7,28 @@ the_object: {
 }?
 the_any: any?
 the_array: int[]?
+the_stream: real[] stream(4)?
+the_short: i16?
+the_float: f32?
+the_bytes: u8[]?
+the_counter: u64?
+the_items: {
+    the_id: int.
+    the_name: string?
+    the_tags: string[]?
+    the_kind: enum(small, large)?
+    the_host: string interned?
+    the_code: string(8)?
+}[]?
+the_samples: {
+    the_time: i64.
+    the_value: real?
+    the_valid: bool?
+}[] columnar?
+the_matrix: real[][]?
+the_status: enum(ok, degraded, down)?
+the_label: string(4)?
+the_pair: {
+    the_list: { the_x: int. }[]?
+}?
+the_pair_the_list: { the_y: int. }[]?